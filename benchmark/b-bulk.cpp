@@ -0,0 +1,102 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <picobench/picobench.hpp>
+
+#include <xmem/shared_ptr.hpp>
+#include <xmem/bulk.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// bulk operations against plain loops over the same pointers
+// the pointers are shuffled, so the control blocks are visited in an order which the hardware
+// prefetcher can't follow
+// the iterations are the number of pointers and only the operation itself is timed
+
+namespace {
+
+struct integer {
+    integer(uint32_t n) : val(n) {}
+    uint32_t val;
+};
+
+// n objects and a shuffled copy of the pointers to them
+// the copies don't hold the last refs, so resetting them only touches the control blocks
+struct population {
+    std::vector<xmem::shared_ptr<integer>> objects;
+    std::vector<xmem::shared_ptr<integer>> shuffled;
+
+    explicit population(size_t n) {
+        std::minstd_rand rnd(42);
+        objects.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            objects.push_back(xmem::make_shared<integer>(rnd()));
+        }
+        shuffled = objects;
+        std::shuffle(shuffled.begin(), shuffled.end(), rnd);
+    }
+};
+
+template <bool Bulk>
+void reset(picobench::state& pb) {
+    population pop(size_t(pb.iterations()));
+    auto& ptrs = pop.shuffled;
+    {
+        picobench::scope scope(pb);
+        if constexpr (Bulk) {
+            xmem::reset_all(ptrs.data(), ptrs.size());
+        }
+        else {
+            for (auto& p : ptrs) p.reset();
+        }
+    }
+    pb.set_result(pop.objects.front().use_count());
+}
+
+template <bool Bulk>
+void lock(picobench::state& pb) {
+    population pop(size_t(pb.iterations()));
+    std::vector<xmem::weak_ptr<integer>> weak(pop.shuffled.begin(), pop.shuffled.end());
+    pop.shuffled.clear();
+    // have half of the objects expire
+    for (size_t i = 0; i < pop.objects.size(); i += 2) {
+        pop.objects[i].reset();
+    }
+    std::vector<xmem::shared_ptr<integer>> out(weak.size());
+
+    uint32_t sum = 0;
+    {
+        picobench::scope scope(pb);
+        size_t num_locked = 0;
+        if constexpr (Bulk) {
+            num_locked = xmem::lock_all(weak.data(), weak.size(), out.data());
+        }
+        else {
+            for (auto& w : weak) {
+                out[num_locked] = w.lock();
+                if (out[num_locked]) ++num_locked;
+            }
+        }
+        for (size_t i = 0; i < num_locked; ++i) {
+            sum += out[i]->val;
+        }
+    }
+    pb.set_result(sum);
+}
+
+}
+
+void reset_loop(picobench::state& pb) { reset<false>(pb); }
+void reset_all(picobench::state& pb) { reset<true>(pb); }
+void lock_loop(picobench::state& pb) { lock<false>(pb); }
+void lock_all(picobench::state& pb) { lock<true>(pb); }
+
+PICOBENCH_SUITE("reset");
+PICOBENCH(reset_loop).iterations({1 << 12, 1 << 16, 1 << 20});
+PICOBENCH(reset_all).iterations({1 << 12, 1 << 16, 1 << 20});
+
+PICOBENCH_SUITE("lock");
+PICOBENCH(lock_loop).iterations({1 << 12, 1 << 16, 1 << 20});
+PICOBENCH(lock_all).iterations({1 << 12, 1 << 16, 1 << 20});
@@ -0,0 +1,89 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <picobench/picobench.hpp>
+
+#include <xmem/lru_cache.hpp>
+
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+// lookups in a cache shared by a number of threads, inserting on misses
+// the keys are skewed towards the small ones and the cache fits a quarter of them
+// the iterations are the total number of lookups
+
+namespace {
+
+struct value {
+    uint64_t payload[8] = {};
+};
+
+constexpr uint32_t num_keys = 1 << 16;
+
+template <unsigned Threads>
+void lookup(picobench::state& pb) {
+    xmem::lru_cache<uint32_t, value> cache(num_keys / 4, 64);
+    auto ops = size_t(pb.iterations()) / Threads;
+
+    auto proc = [&](unsigned seed) {
+        std::minstd_rand rnd(seed);
+        uint64_t hits = 0;
+        for (size_t i = 0; i < ops; ++i) {
+            auto key = uint32_t(rnd() % (rnd() % num_keys + 1));
+            if (auto p = cache.get(key)) {
+                hits += p->payload[0] == key;
+            }
+            else {
+                auto v = xmem::make_shared<value>();
+                v->payload[0] = key;
+                cache.insert(key, std::move(v));
+            }
+        }
+        return hits;
+    };
+
+    std::vector<uint64_t> hits(Threads);
+    {
+        picobench::scope scope(pb);
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < Threads; ++i) {
+            threads.emplace_back([&, i]() { hits[i] = proc(i + 1); });
+        }
+        hits[0] = proc(1);
+        for (auto& t : threads) t.join();
+    }
+
+    uint64_t sum = 0;
+    for (auto h : hits) sum += h;
+    pb.set_result(sum);
+}
+
+}
+
+void lookup_1_thread(picobench::state& pb) {
+    lookup<1>(pb);
+}
+void lookup_2_threads(picobench::state& pb) {
+    lookup<2>(pb);
+}
+void lookup_4_threads(picobench::state& pb) {
+    lookup<4>(pb);
+}
+void lookup_8_threads(picobench::state& pb) {
+    lookup<8>(pb);
+}
+void lookup_16_threads(picobench::state& pb) {
+    lookup<16>(pb);
+}
+void lookup_32_threads(picobench::state& pb) {
+    lookup<32>(pb);
+}
+
+PICOBENCH(lookup_1_thread).iterations({1'000'000}).samples(3);
+PICOBENCH(lookup_2_threads).iterations({1'000'000}).samples(3);
+PICOBENCH(lookup_4_threads).iterations({1'000'000}).samples(3);
+PICOBENCH(lookup_8_threads).iterations({1'000'000}).samples(3);
+PICOBENCH(lookup_16_threads).iterations({1'000'000}).samples(3);
+PICOBENCH(lookup_32_threads).iterations({1'000'000}).samples(3);
@@ -0,0 +1,58 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <picobench/picobench.hpp>
+
+#include <xmem/parallel_release.hpp>
+
+#include <random>
+#include <vector>
+
+// tear down a random tree with a number of threads
+// the iterations are the number of nodes
+
+namespace {
+
+struct node {
+    uint64_t payload[4] = {};
+    std::vector<xmem::teardown_shared_ptr<node>> children;
+};
+
+xmem::teardown_shared_ptr<node> make_tree(size_t n) {
+    std::minstd_rand rnd(42);
+    std::vector<xmem::teardown_shared_ptr<node>> nodes;
+    nodes.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        nodes.push_back(xmem::make_teardown_shared<node>());
+        nodes.back()->payload[0] = i;
+        if (i) nodes[rnd() % i]->children.push_back(nodes.back());
+    }
+    return nodes.front();
+}
+
+template <unsigned Threads>
+void teardown(picobench::state& pb) {
+    static xmem::release_pool pool(Threads);
+
+    std::vector<xmem::teardown_shared_ptr<node>> roots;
+    roots.push_back(make_tree(size_t(pb.iterations())));
+
+    picobench::scope scope(pb);
+    xmem::parallel_release(std::move(roots), pool);
+}
+
+}
+
+void teardown_1_thread(picobench::state& pb) {
+    teardown<1>(pb);
+}
+void teardown_4_threads(picobench::state& pb) {
+    teardown<4>(pb);
+}
+void teardown_16_threads(picobench::state& pb) {
+    teardown<16>(pb);
+}
+
+PICOBENCH(teardown_1_thread).iterations({1'000'000, 10'000'000}).samples(1);
+PICOBENCH(teardown_4_threads).iterations({1'000'000, 10'000'000}).samples(1);
+PICOBENCH(teardown_16_threads).iterations({1'000'000, 10'000'000}).samples(1);
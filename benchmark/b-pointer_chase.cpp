@@ -0,0 +1,127 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <picobench/picobench.hpp>
+
+#include <xmem/shared_ptr.hpp>
+#include <xmem/huge_page_allocator.hpp>
+
+#include <random>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+#   include <linux/perf_event.h>
+#   include <sys/ioctl.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+// chase pointers through a large population of shared objects in random order
+// the result is the number of dTLB read misses during the chase (or 0 if perf events are unavailable)
+
+namespace {
+
+struct dtlb_counter {
+#if defined(__linux__) && defined(__NR_perf_event_open)
+    int fd = -1;
+    dtlb_counter() {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~dtlb_counter() {
+        if (fd >= 0) close(fd);
+    }
+    void start() {
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    uint64_t stop() {
+        if (fd < 0) return 0;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t ret = 0;
+        if (read(fd, &ret, sizeof(ret)) != sizeof(ret)) return 0;
+        return ret;
+    }
+#else
+    void start() {}
+    uint64_t stop() { return 0; }
+#endif
+};
+
+struct node {
+    node* next = nullptr;
+    uint64_t payload = 0;
+};
+
+constexpr size_t population = 1 << 20;
+
+template <typename Alloc>
+struct chase_population {
+    std::vector<xmem::shared_ptr<node>> nodes;
+
+    chase_population() {
+        nodes.reserve(population);
+        for (size_t i = 0; i < population; ++i) {
+            nodes.push_back(xmem::allocate_shared<node>(Alloc{}));
+            nodes.back()->payload = i;
+        }
+        // link in a random cycle
+        std::vector<size_t> order(population);
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::shuffle(order.begin(), order.end(), std::minstd_rand(42));
+        for (size_t i = 0; i < population; ++i) {
+            nodes[order[i]]->next = nodes[order[(i + 1) % population]].get();
+        }
+    }
+
+    static chase_population& instance() {
+        static chase_population p;
+        return p;
+    }
+};
+
+template <typename Alloc>
+void chase(picobench::state& pb) {
+    auto& pop = chase_population<Alloc>::instance();
+    dtlb_counter counter;
+
+    uint64_t sum = 0;
+    node* n = pop.nodes.front().get();
+    counter.start();
+    {
+        picobench::scope scope(pb);
+        for (int i = 0; i < pb.iterations(); ++i) {
+            sum += n->payload;
+            n = n->next;
+        }
+    }
+    auto misses = counter.stop();
+    if (sum == 42) misses = 0; // prevent the chase from being optimized away
+
+    pb.set_result(misses);
+}
+
+}
+
+void chase_default_alloc(picobench::state& pb) {
+    chase<xmem::allocator<char>>(pb);
+}
+void chase_huge_page_alloc(picobench::state& pb) {
+    chase<xmem::huge_page_allocator<char>>(pb);
+}
+
+PICOBENCH(chase_default_alloc).iterations({1 << 16, 1 << 20, 1 << 22});
+PICOBENCH(chase_huge_page_alloc).iterations({1 << 16, 1 << 20, 1 << 22});
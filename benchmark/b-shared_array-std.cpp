@@ -0,0 +1,16 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <memory>
+
+#define FUNC std_shared_array
+#define sptr std::shared_ptr
+
+#if __cplusplus >= 202000
+#   define make_array(n) std::make_shared<uint32_t[]>(n)
+#else
+#   define make_array(n) sptr<uint32_t[]>(new uint32_t[n]())
+#endif
+
+#include "b-shared_array.inl"
+PICOBENCH(std_shared_array);
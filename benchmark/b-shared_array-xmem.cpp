@@ -0,0 +1,21 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xmem/shared_ptr.hpp>
+
+#define sptr xmem::shared_ptr
+
+// single allocation: the elements are in the control block
+#define FUNC xmem_make_shared_array
+#define make_array(n) xmem::make_shared<uint32_t[]>(n)
+#include "b-shared_array.inl"
+PICOBENCH(xmem_make_shared_array);
+
+#undef FUNC
+#undef make_array
+
+// two allocations: the array and the control block holding the unique_ptr
+#define FUNC xmem_uptr_shared_array
+#define make_array(n) sptr<uint32_t[]>(xmem::make_unique<uint32_t[]>(n))
+#include "b-shared_array.inl"
+PICOBENCH(xmem_uptr_shared_array);
@@ -0,0 +1,30 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <picobench/picobench.hpp>
+#include <random>
+#include <vector>
+
+// inline file - no include guard
+
+void FUNC(picobench::state& pb) {
+    std::minstd_rand rnd(42);
+    std::vector<sptr<uint32_t[]>> alloc(size_t(pb.iterations())); // keep initial allocation out of scope
+    uint32_t sum = 0;
+
+    picobench::scope scope(pb);
+    auto arrays = std::move(alloc);
+
+    for (auto& a : arrays) {
+        auto size = 1 + rnd() % 16;
+        a = make_array(size);
+        a[size - 1] = rnd();
+        sum += a[size - 1] + a[0];
+    }
+    // have roughly half expire
+    for (auto& a : arrays) {
+        if (rnd() % 2) a.reset();
+    }
+
+    pb.set_result(sum);
+}
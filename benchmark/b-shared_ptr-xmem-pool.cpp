@@ -0,0 +1,12 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xmem/pool_shared_ptr.hpp>
+
+#define FUNC xmem_pool_sptr
+#define sptr xmem::shared_ptr
+#define wptr xmem::weak_ptr
+#define make xmem::make_pool_shared
+
+#include "b-shared_ptr.inl"
+PICOBENCH(xmem_pool_sptr);
@@ -0,0 +1,17 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <xmem/shared_ptr.hpp>
+
+template <typename T, typename... Args>
+xmem::shared_ptr<T> make_std_alloc_shared(Args&&... args) {
+    return xmem::allocate_shared<T>(std::allocator<char>{}, std::forward<Args>(args)...);
+}
+
+#define FUNC xmem_std_alloc_sptr
+#define sptr xmem::shared_ptr
+#define wptr xmem::weak_ptr
+#define make make_std_alloc_shared
+
+#include "b-shared_ptr.inl"
+PICOBENCH(xmem_std_alloc_sptr);
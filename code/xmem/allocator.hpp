@@ -19,13 +19,27 @@ public:
 
     static inline constexpr std::align_val_t align_val{alignof(T)};
 
+    // the aligned overloads of new and delete are only used when needed, as they are typically slower
+    static inline constexpr bool overaligned = alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
     [[nodiscard]] T* allocate(size_t n) {
-        auto ret = ::operator new(n * sizeof(T), align_val);
+        void* ret;
+        if constexpr (overaligned) {
+            ret = ::operator new(n * sizeof(T), align_val);
+        }
+        else {
+            ret = ::operator new(n * sizeof(T));
+        }
         return reinterpret_cast<T*>(ret);
     }
     void deallocate(T* ptr, size_t) {
         auto del = reinterpret_cast<void*>(ptr);
-        ::operator delete(del, align_val);
+        if constexpr (overaligned) {
+            ::operator delete(del, align_val);
+        }
+        else {
+            ::operator delete(del);
+        }
     }
 };
 
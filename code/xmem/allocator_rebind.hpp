@@ -6,8 +6,13 @@
 
 namespace xmem {
 
+// allocators which are not a simple Alloc<T> are rebound through their traits
+// (std::allocator_traits will replace the first template argument if there is no rebind member)
 template <typename Alloc>
-struct allocator_rebind;
+struct allocator_rebind {
+    template <typename U>
+    using to = typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+};
 
 template <template <typename> class Alloc, typename T>
 struct allocator_rebind<Alloc<T>> {
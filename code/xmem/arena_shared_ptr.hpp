@@ -0,0 +1,17 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "local_shared_ptr.hpp"
+#include "bump_arena.hpp"
+
+namespace xmem {
+
+// the control block and the object are allocated from a bump arena
+// the object is destroyed as usual, but the memory is only reclaimed when the arena is reset
+template <typename T, typename... Args>
+[[nodiscard]] local_shared_ptr<T> make_local_arena_shared(bump_arena& arena, Args&&... args) {
+    return local_shared_ptr<T>(local_control_block_factory::make_resource_cb<T>(arena_allocator<char>(arena), std::forward<Args>(args)...));
+}
+
+}
@@ -0,0 +1,365 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "basic_shared_ptr.hpp"
+#include "offset_arena.hpp"
+
+#include <cassert>
+
+namespace xmem {
+
+// Compressed shared pointers store 32-bit offsets into the arena of a domain (see offset_arena.hpp)
+// instead of raw pointers:
+// * basic_compressed_shared_ptr stores the control block and the object (8 bytes). It can be aliased,
+//   as long as the alias is also in the arena. Offsets are in units of offset_arena::granularity, so
+//   pointers which are not aligned to it (say a char member or a base class at offset 4) can't be
+//   stored. Aliases and conversions to such pointers are refused and result in a null pointer.
+// * basic_compressed_thin_shared_ptr stores only the control block (4 bytes) and derives the object from it
+//   like basic_thin_shared_ptr
+// Both work with any control block factory and convert to basic_shared_ptr
+// Objects are created with the factory through offset_allocator<char, Domain>
+
+template <typename CBF, typename Domain, typename T>
+class basic_compressed_shared_ptr {
+public:
+    using element_type = std::remove_extent_t<T>;
+    using control_block_type = typename CBF::cb_type;
+    using domain_type = Domain;
+    using offset_type = offset_arena::offset_type;
+    using cb_ptr_pair_type = cb_ptr_pair<control_block_type, element_type>;
+
+    basic_compressed_shared_ptr() noexcept : m_cb(0), m_ptr(0) {}
+    basic_compressed_shared_ptr(std::nullptr_t) noexcept : basic_compressed_shared_ptr() {};
+
+    basic_compressed_shared_ptr(const basic_compressed_shared_ptr& r) noexcept {
+        init_from_copy(r);
+    }
+    basic_compressed_shared_ptr& operator=(const basic_compressed_shared_ptr& r) noexcept {
+        if (&r == this) return *this; // self usurp
+        if (m_cb) cb()->dec_strong_ref(this);
+        init_from_copy(r);
+        return *this;
+    }
+
+    template <typename U>
+    basic_compressed_shared_ptr(const basic_compressed_shared_ptr<CBF, Domain, U>& r) noexcept {
+        init_from_copy(r);
+    }
+    template <typename U>
+    basic_compressed_shared_ptr& operator=(const basic_compressed_shared_ptr<CBF, Domain, U>& r) noexcept {
+        if (m_cb) cb()->dec_strong_ref(this);
+        init_from_copy(r);
+        return *this;
+    }
+
+    basic_compressed_shared_ptr(basic_compressed_shared_ptr&& r) noexcept {
+        init_from_move(r);
+    }
+    basic_compressed_shared_ptr& operator=(basic_compressed_shared_ptr&& r) noexcept {
+        if (&r == this) return *this; // self usurp
+        if (m_cb) cb()->dec_strong_ref(this);
+        init_from_move(r);
+        return *this;
+    }
+
+    template <typename U>
+    basic_compressed_shared_ptr(basic_compressed_shared_ptr<CBF, Domain, U>&& r) noexcept {
+        init_from_move(r);
+    }
+    template <typename U>
+    basic_compressed_shared_ptr& operator=(basic_compressed_shared_ptr<CBF, Domain, U>&& r) noexcept {
+        if (m_cb) cb()->dec_strong_ref(this);
+        init_from_move(r);
+        return *this;
+    }
+
+    // aliasing
+    // if aptr is not addressable in the arena, the result is null
+    template <typename U>
+    basic_compressed_shared_ptr(const basic_compressed_shared_ptr<CBF, Domain, U>& r, element_type* aptr) noexcept {
+        if (!arena().addressable(aptr)) {
+            m_cb = m_ptr = 0;
+            return;
+        }
+        m_cb = r.m_cb;
+        m_ptr = arena().to_offset(aptr);
+        if (m_cb) cb()->inc_strong_ref(this);
+    }
+
+    // compress a full pointer. Both the owner and the object must be addressable in the arena of the domain
+    // (otherwise the result is null)
+    template <typename U>
+    explicit basic_compressed_shared_ptr(const basic_shared_ptr<CBF, U>& r) noexcept {
+        if (!arena().addressable(r.t_owner()) || !arena().addressable(r.get())) {
+            m_cb = m_ptr = 0;
+            return;
+        }
+        m_cb = arena().to_offset(r.t_owner());
+        m_ptr = arena().to_offset(r.get());
+        if (m_cb) cb()->inc_strong_ref(this);
+    }
+
+    // new! rc taken care of by the factory (use offset_allocator<char, Domain> to create it)
+    explicit basic_compressed_shared_ptr(cb_ptr_pair_type&& cbptr) noexcept {
+        assert(arena().addressable(cbptr.cb) && arena().addressable(cbptr.ptr));
+        m_cb = arena().to_offset(cbptr.cb);
+        m_ptr = arena().to_offset(cbptr.ptr);
+        cbptr.reset();
+        if (m_cb) cb()->init_strong(this);
+    }
+
+    ~basic_compressed_shared_ptr() {
+        if (m_cb) cb()->dec_strong_ref(this);
+    }
+
+    void reset(std::nullptr_t = nullptr) noexcept {
+        if (m_cb) cb()->dec_strong_ref(this);
+        m_cb = 0;
+        m_ptr = 0;
+    }
+
+    void swap(basic_compressed_shared_ptr& r) noexcept {
+        // same as basic_shared_ptr: we want to make sane transfer_strong calls
+        if (m_cb != r.m_cb) {
+            if (m_cb) cb()->transfer_strong(&r, this);
+            std::swap(m_cb, r.m_cb);
+            std::swap(m_ptr, r.m_ptr);
+            if (m_cb) cb()->transfer_strong(this, &r);
+        }
+        else {
+            std::swap(m_ptr, r.m_ptr);
+        }
+    }
+
+    [[nodiscard]] element_type* get() const noexcept {
+        return static_cast<element_type*>(arena().from_offset(m_ptr));
+    }
+
+    template <typename TT = T, typename = std::enable_if_t<!std::is_void_v<TT>>>
+    [[nodiscard]] TT& operator*() const noexcept { return *get(); }
+
+    T* operator->() const noexcept { return get(); }
+
+    [[nodiscard]] long use_count() const noexcept {
+        if (!m_cb) return 0;
+        return cb()->strong_ref_count();
+    }
+
+    explicit operator bool() const noexcept { return !!m_ptr; }
+
+    [[nodiscard]] const void* owner() const noexcept { return cb(); }
+    [[nodiscard]] const control_block_type* t_owner() const noexcept { return cb(); }
+
+    // conversion to a full pointer
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<element_type*, U*>>>
+    operator basic_shared_ptr<CBF, U>() const& noexcept {
+        basic_shared_ptr<CBF, U> ret;
+        ret.init_from_copy(cb_ptr_pair_type(cb(), get()));
+        return ret;
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<element_type*, U*>>>
+    operator basic_shared_ptr<CBF, U>() && noexcept {
+        basic_shared_ptr<CBF, U> ret;
+        ret.m = cb_ptr_pair_type(cb(), get());
+        if (m_cb) cb()->transfer_strong(&ret, this);
+        m_cb = 0;
+        m_ptr = 0;
+        return ret;
+    }
+
+    [[nodiscard]] basic_shared_ptr<CBF, T> to_shared() const& noexcept { return *this; }
+    [[nodiscard]] basic_shared_ptr<CBF, T> to_shared() && noexcept { return std::move(*this); }
+
+private:
+    static offset_arena& arena() noexcept { return Domain::arena(); }
+
+    control_block_type* cb() const noexcept {
+        return static_cast<control_block_type*>(arena().from_offset(m_cb));
+    }
+
+    template <typename U>
+    void init_from_copy(const basic_compressed_shared_ptr<CBF, Domain, U>& r) noexcept {
+        static_assert(std::is_convertible_v<typename basic_compressed_shared_ptr<CBF, Domain, U>::element_type*, element_type*>,
+            "bad compressed pointer conversion");
+        element_type* p = r.get();
+        if (!arena().addressable(p)) {
+            // the conversion adjusted the pointer to an unaligned base
+            m_cb = m_ptr = 0;
+            return;
+        }
+        m_cb = r.m_cb;
+        m_ptr = arena().to_offset(p);
+        if (m_cb) cb()->inc_strong_ref(this);
+    }
+
+    template <typename U>
+    void init_from_move(basic_compressed_shared_ptr<CBF, Domain, U>& r) noexcept {
+        element_type* p = r.get();
+        if (!arena().addressable(p)) {
+            // refused like the copy (r keeps its ref)
+            m_cb = m_ptr = 0;
+            return;
+        }
+        m_cb = r.m_cb;
+        m_ptr = arena().to_offset(p);
+        r.m_cb = 0;
+        r.m_ptr = 0;
+        if (m_cb) cb()->transfer_strong(this, &r);
+    }
+
+    offset_type m_cb;
+    offset_type m_ptr;
+
+    template <typename, typename, typename> friend class basic_compressed_shared_ptr;
+};
+
+template <typename CBF, typename Domain, typename T>
+class basic_compressed_thin_shared_ptr {
+public:
+    using element_type = T;
+    using control_block_type = typename CBF::cb_type;
+    using domain_type = Domain;
+    using offset_type = offset_arena::offset_type;
+    using allocator_type = offset_allocator<char, Domain>;
+
+    static_assert(!std::is_array_v<T> && !std::is_void_v<T>, "thin pointers need a complete object type");
+
+    basic_compressed_thin_shared_ptr() noexcept : m_cb(0) {}
+    basic_compressed_thin_shared_ptr(std::nullptr_t) noexcept : basic_compressed_thin_shared_ptr() {};
+
+    basic_compressed_thin_shared_ptr(const basic_compressed_thin_shared_ptr& r) noexcept {
+        init_from_copy(r.m_cb);
+    }
+    basic_compressed_thin_shared_ptr& operator=(const basic_compressed_thin_shared_ptr& r) noexcept {
+        if (&r == this) return *this; // self usurp
+        if (m_cb) cb()->dec_strong_ref(this);
+        init_from_copy(r.m_cb);
+        return *this;
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_same_v<std::remove_cv_t<U>, std::remove_cv_t<T>>>>
+    basic_compressed_thin_shared_ptr(const basic_compressed_thin_shared_ptr<CBF, Domain, U>& r) noexcept {
+        static_assert(std::is_convertible_v<U*, T*>, "bad thin pointer conversion");
+        init_from_copy(r.m_cb);
+    }
+
+    basic_compressed_thin_shared_ptr(basic_compressed_thin_shared_ptr&& r) noexcept {
+        init_from_move(r);
+    }
+    basic_compressed_thin_shared_ptr& operator=(basic_compressed_thin_shared_ptr&& r) noexcept {
+        if (&r == this) return *this; // self usurp
+        if (m_cb) cb()->dec_strong_ref(this);
+        init_from_move(r);
+        return *this;
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_same_v<std::remove_cv_t<U>, std::remove_cv_t<T>>>>
+    basic_compressed_thin_shared_ptr(basic_compressed_thin_shared_ptr<CBF, Domain, U>&& r) noexcept {
+        static_assert(std::is_convertible_v<U*, T*>, "bad thin pointer conversion");
+        init_from_move(r);
+    }
+
+    // new! the control block must have been created by CBF::make_thin_cb<T> with allocator_type
+    explicit basic_compressed_thin_shared_ptr(control_block_type* cb) noexcept {
+        assert(arena().addressable(cb));
+        m_cb = arena().to_offset(cb);
+        if (m_cb) cb->init_strong(this);
+    }
+
+    ~basic_compressed_thin_shared_ptr() {
+        if (m_cb) cb()->dec_strong_ref(this);
+    }
+
+    void reset(std::nullptr_t = nullptr) noexcept {
+        if (m_cb) cb()->dec_strong_ref(this);
+        m_cb = 0;
+    }
+
+    void swap(basic_compressed_thin_shared_ptr& r) noexcept {
+        if (m_cb == r.m_cb) return;
+        if (m_cb) cb()->transfer_strong(&r, this);
+        std::swap(m_cb, r.m_cb);
+        if (m_cb) cb()->transfer_strong(this, &r);
+    }
+
+    [[nodiscard]] T* get() const noexcept {
+        if (!m_cb) return nullptr;
+        return CBF::template thin_obj<T, allocator_type>(cb());
+    }
+
+    [[nodiscard]] T& operator*() const noexcept { return *get(); }
+    T* operator->() const noexcept { return get(); }
+
+    [[nodiscard]] long use_count() const noexcept {
+        if (!m_cb) return 0;
+        return cb()->strong_ref_count();
+    }
+
+    explicit operator bool() const noexcept { return !!m_cb; }
+
+    [[nodiscard]] const void* owner() const noexcept { return cb(); }
+    [[nodiscard]] const control_block_type* t_owner() const noexcept { return cb(); }
+
+    // conversion to full pointers
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<T*, U*>>>
+    operator basic_shared_ptr<CBF, U>() const& noexcept {
+        basic_shared_ptr<CBF, U> ret;
+        ret.init_from_copy(cb_ptr_pair<control_block_type, T>(cb(), get()));
+        return ret;
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<T*, U*>>>
+    operator basic_shared_ptr<CBF, U>() && noexcept {
+        basic_shared_ptr<CBF, U> ret;
+        if (!m_cb) return ret;
+        ret.m = cb_ptr_pair<control_block_type, T>(cb(), get());
+        cb()->transfer_strong(&ret, this);
+        m_cb = 0;
+        return ret;
+    }
+
+    [[nodiscard]] basic_shared_ptr<CBF, T> to_shared() const& noexcept { return *this; }
+    [[nodiscard]] basic_shared_ptr<CBF, T> to_shared() && noexcept { return std::move(*this); }
+
+private:
+    static offset_arena& arena() noexcept { return Domain::arena(); }
+
+    control_block_type* cb() const noexcept {
+        return static_cast<control_block_type*>(arena().from_offset(m_cb));
+    }
+
+    void init_from_copy(offset_type cb_offset) noexcept {
+        m_cb = cb_offset;
+        if (m_cb) cb()->inc_strong_ref(this);
+    }
+
+    template <typename U>
+    void init_from_move(basic_compressed_thin_shared_ptr<CBF, Domain, U>& r) noexcept {
+        m_cb = r.m_cb;
+        r.m_cb = 0;
+        if (m_cb) cb()->transfer_strong(this, &r);
+    }
+
+    offset_type m_cb;
+
+    template <typename, typename, typename> friend class basic_compressed_thin_shared_ptr;
+};
+
+// compare
+template <typename CBF1, typename D1, typename T1, typename CBF2, typename D2, typename T2>
+[[nodiscard]] bool operator==(const basic_compressed_shared_ptr<CBF1, D1, T1>& s1, const basic_compressed_shared_ptr<CBF2, D2, T2>& s2) { return s1.get() == s2.get(); }
+template <typename CBF1, typename D1, typename T1, typename CBF2, typename D2, typename T2>
+[[nodiscard]] bool operator!=(const basic_compressed_shared_ptr<CBF1, D1, T1>& s1, const basic_compressed_shared_ptr<CBF2, D2, T2>& s2) { return s1.get() != s2.get(); }
+template <typename CBF1, typename D1, typename T1, typename CBF2, typename D2, typename T2>
+[[nodiscard]] bool operator==(const basic_compressed_thin_shared_ptr<CBF1, D1, T1>& s1, const basic_compressed_thin_shared_ptr<CBF2, D2, T2>& s2) { return s1.owner() == s2.owner(); }
+template <typename CBF1, typename D1, typename T1, typename CBF2, typename D2, typename T2>
+[[nodiscard]] bool operator!=(const basic_compressed_thin_shared_ptr<CBF1, D1, T1>& s1, const basic_compressed_thin_shared_ptr<CBF2, D2, T2>& s2) { return s1.owner() != s2.owner(); }
+
+template <typename CBF, typename Domain, typename T>
+[[nodiscard]] bool no_owner(const basic_compressed_shared_ptr<CBF, Domain, T>& ptr) { return !ptr.owner(); }
+template <typename CBF, typename Domain, typename T>
+[[nodiscard]] bool no_owner(const basic_compressed_thin_shared_ptr<CBF, Domain, T>& ptr) { return !ptr.owner(); }
+
+} // namespace xmem
@@ -4,6 +4,7 @@
 #pragma once
 #include "cb_ptr_pair.hpp"
 #include "unique_ptr.hpp"
+#include "control_block_deleter.hpp"
 
 namespace xmem {
 
@@ -13,6 +14,15 @@ class basic_weak_ptr;
 template <typename CBF>
 class basic_enable_shared_from;
 
+template <typename CBF, typename T>
+class basic_thin_shared_ptr;
+
+template <typename CBF, typename Domain, typename T>
+class basic_compressed_shared_ptr;
+
+template <typename CBF, typename Domain, typename T>
+class basic_compressed_thin_shared_ptr;
+
 template <typename CBF, typename T>
 class basic_shared_ptr {
 public:
@@ -78,17 +88,40 @@ public:
         return *this;
     }
 
+    // the object is already in a control block: no allocation
+    template <typename U>
+    basic_shared_ptr(unique_ptr<U, control_block_deleter<CBF>>&& uptr) noexcept {
+        init_from_shareable(uptr);
+    }
+
+    template <typename U>
+    basic_shared_ptr& operator=(unique_ptr<U, control_block_deleter<CBF>>&& uptr) noexcept {
+        if (m.cb) m.cb->dec_strong_ref(this);
+        init_from_shareable(uptr);
+        return *this;
+    }
+
     template <typename D>
     basic_shared_ptr(std::nullptr_t, D d) : basic_shared_ptr(unique_ptr<T, D>(nullptr, std::move(d))) {}
 
     template <typename U>
-    explicit basic_shared_ptr(U* p) : basic_shared_ptr(unique_ptr<U>(p)) {}
+    explicit basic_shared_ptr(U* p) : basic_shared_ptr(unique_ptr<owned_type<U>>(p)) {}
 
     template <typename U, typename D>
     basic_shared_ptr(U* p, D d) : basic_shared_ptr(unique_ptr<U, D>(p, std::move(d))) {}
 
+    // the control block is allocated with a (the deleter is called if the allocation throws)
+    template <typename U, typename D, typename A>
+    basic_shared_ptr(U* p, D d, A a) {
+        unique_ptr<owned_type<U>, D> uptr(p, std::move(d));
+        init_new(CBF::make_uptr_cb(uptr, std::move(a)));
+    }
+
+    template <typename D, typename A>
+    basic_shared_ptr(std::nullptr_t, D d, A a) : basic_shared_ptr(static_cast<element_type*>(nullptr), std::move(d), std::move(a)) {}
+
     template <typename U>
-    basic_shared_ptr(const basic_shared_ptr<CBF, U>& r, T* aptr) noexcept {
+    basic_shared_ptr(const basic_shared_ptr<CBF, U>& r, element_type* aptr) noexcept {
         init_from_copy(cb_ptr_pair_type(r.m.cb, aptr));
     }
 
@@ -107,16 +140,21 @@ public:
 
     template <typename U>
     void reset(U* u) {
-        operator=(unique_ptr<U>(u));
+        operator=(unique_ptr<owned_type<U>>(u));
     }
 
     template <typename U, typename D>
     void reset(U* u, D d) {
-        operator=(unique_ptr<U>(u, std::move(d)));
+        operator=(unique_ptr<owned_type<U>, D>(u, std::move(d)));
     }
 
     template <typename U, typename D, typename A>
-    void reset(U* u, D d, A a);
+    void reset(U* u, D d, A a) {
+        unique_ptr<owned_type<U>, D> uptr(u, std::move(d));
+        auto cbptr = CBF::make_uptr_cb(uptr, std::move(a));
+        if (m.cb) m.cb->dec_strong_ref(this);
+        init_new(std::move(cbptr));
+    }
 
     void swap(basic_shared_ptr& r) noexcept {
         // a self usurp check wouldn't be needed here in a conventional implementation,
@@ -141,6 +179,20 @@ public:
     template <typename TT = T, typename Elem = element_type, typename = std::enable_if_t<!std::is_void_v<TT>> >
     [[nodiscard]] Elem& operator[](size_t i) const noexcept { return m.ptr[i]; }
 
+    // if this is the only owner (there are no other shared or weak pointers to the control block),
+    // transfer the ownership to a unique_ptr, which can later be shared again without an allocation
+    // otherwise (or if the pointer is null) return null and leave this unchanged
+    [[nodiscard]] unique_ptr<T, control_block_deleter<CBF>> unshare() noexcept {
+        unique_ptr<T, control_block_deleter<CBF>> ret;
+        if (!m.ptr || !m.cb || m.cb->strong_ref_count() != 1 || m.cb->weak_ref_count() != 1) return ret;
+        auto& d = ret.get_deleter();
+        d.m_cb = m.cb;
+        m.cb->transfer_strong(&d, this);
+        ret.reset(m.ptr);
+        m.reset();
+        return ret;
+    }
+
     [[nodiscard]] long use_count() const noexcept {
         if (!m.cb) return 0;
         return m.cb->strong_ref_count();
@@ -157,6 +209,10 @@ public:
     }
 
 private:
+    // raw pointers to arrays are deleted with delete[]
+    template <typename U>
+    using owned_type = std::conditional_t<std::is_array_v<T>, U[], U>;
+
     // not new! rc taken care of from the outside
     explicit basic_shared_ptr(const cb_ptr_pair_type& cbptr) noexcept : m(cbptr) {}
 
@@ -178,11 +234,25 @@ private:
         if (m.cb) m.cb->transfer_strong(this, &r);
     }
 
+    template <typename U>
+    void init_from_shareable(unique_ptr<U, control_block_deleter<CBF>>& uptr) noexcept {
+        auto& d = uptr.get_deleter();
+        m.cb = d.m_cb;
+        m.ptr = uptr.release();
+        d.m_cb = nullptr;
+        if (m.cb) m.cb->transfer_strong(this, &d);
+    }
+
     cb_ptr_pair_type m;
 
     template <typename, typename> friend class basic_shared_ptr;
     template <typename, typename> friend class basic_weak_ptr;
     template <typename> friend class basic_enable_shared_from;
+    template <typename, typename> friend class basic_thin_shared_ptr;
+    template <typename, typename, typename> friend class basic_compressed_shared_ptr;
+    template <typename, typename, typename> friend class basic_compressed_thin_shared_ptr;
+    template <typename> friend struct relocation_traits;
+    template <typename, typename> friend class basic_weak_ptr_vector;
 };
 
 // compare
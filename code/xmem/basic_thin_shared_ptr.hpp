@@ -0,0 +1,179 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "basic_shared_ptr.hpp"
+
+#include <functional> // std::hash
+
+namespace xmem {
+
+// A shared pointer which only holds the control block (thus it's one pointer wide)
+// The object address is derived from the control block, which means that
+// it can only point to objects created together with their control block (make_thin_shared and friends)
+// Aliasing is not supported, but a thin pointer can be converted to basic_shared_ptr which supports it
+template <typename CBF, typename T>
+class basic_thin_shared_ptr {
+public:
+    using element_type = T;
+    using control_block_type = typename CBF::cb_type;
+    using shared_type = basic_shared_ptr<CBF, T>;
+
+    static_assert(!std::is_array_v<T> && !std::is_void_v<T>, "thin pointers need a complete object type");
+
+    basic_thin_shared_ptr() noexcept : m_cb(nullptr) {}
+    basic_thin_shared_ptr(std::nullptr_t) noexcept : basic_thin_shared_ptr() {};
+
+    basic_thin_shared_ptr(const basic_thin_shared_ptr& r) noexcept {
+        init_from_copy(r.m_cb);
+    }
+    basic_thin_shared_ptr& operator=(const basic_thin_shared_ptr& r) noexcept {
+        if (&r == this) return *this; // self usurp
+        if (m_cb) m_cb->dec_strong_ref(this);
+        init_from_copy(r.m_cb);
+        return *this;
+    }
+
+    // only cv-qualification changes are allowed for thin pointers, as the object type is needed to find it
+    template <typename U, typename = std::enable_if_t<std::is_same_v<std::remove_cv_t<U>, std::remove_cv_t<T>>>>
+    basic_thin_shared_ptr(const basic_thin_shared_ptr<CBF, U>& r) noexcept {
+        static_assert(std::is_convertible_v<U*, T*>, "bad thin pointer conversion");
+        init_from_copy(r.m_cb);
+    }
+
+    basic_thin_shared_ptr(basic_thin_shared_ptr&& r) noexcept {
+        init_from_move(r);
+    }
+    basic_thin_shared_ptr& operator=(basic_thin_shared_ptr&& r) noexcept {
+        if (&r == this) return *this; // self usurp
+        if (m_cb) m_cb->dec_strong_ref(this);
+        init_from_move(r);
+        return *this;
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_same_v<std::remove_cv_t<U>, std::remove_cv_t<T>>>>
+    basic_thin_shared_ptr(basic_thin_shared_ptr<CBF, U>&& r) noexcept {
+        static_assert(std::is_convertible_v<U*, T*>, "bad thin pointer conversion");
+        init_from_move(r);
+    }
+
+    // new! the control block must have been created by CBF::make_thin_cb<T> with allocator<char>
+    explicit basic_thin_shared_ptr(control_block_type* cb) noexcept : m_cb(cb) {
+        if (m_cb) m_cb->init_strong(this);
+    }
+
+    ~basic_thin_shared_ptr() {
+        if (m_cb) m_cb->dec_strong_ref(this);
+    }
+
+    void reset(std::nullptr_t = nullptr) noexcept {
+        if (m_cb) m_cb->dec_strong_ref(this);
+        m_cb = nullptr;
+    }
+
+    void swap(basic_thin_shared_ptr& r) noexcept {
+        // same as basic_shared_ptr: we want to make sane transfer_strong calls
+        if (m_cb == r.m_cb) return;
+        if (m_cb) m_cb->transfer_strong(&r, this);
+        std::swap(m_cb, r.m_cb);
+        if (m_cb) m_cb->transfer_strong(this, &r);
+    }
+
+    [[nodiscard]] T* get() const noexcept {
+        if (!m_cb) return nullptr;
+        return CBF::template thin_obj<T>(m_cb);
+    }
+
+    [[nodiscard]] T& operator*() const noexcept { return *get(); }
+    T* operator->() const noexcept { return get(); }
+
+    [[nodiscard]] long use_count() const noexcept {
+        if (!m_cb) return 0;
+        return m_cb->strong_ref_count();
+    }
+
+    // unlike basic_shared_ptr there is no way to have a non-null object with a null owner
+    explicit operator bool() const noexcept { return !!m_cb; }
+
+    [[nodiscard]] const void* owner() const noexcept { return m_cb; }
+    [[nodiscard]] const control_block_type* t_owner() const noexcept { return m_cb; }
+
+    template <typename UCBF, typename U>
+    [[nodiscard]] bool owner_before(const basic_thin_shared_ptr<UCBF, U>& r) const noexcept {
+        return m_cb < r.m_cb;
+    }
+
+    // conversion to a full pointer
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<T*, U*>>>
+    operator basic_shared_ptr<CBF, U>() const& noexcept {
+        basic_shared_ptr<CBF, U> ret;
+        ret.init_from_copy(cb_ptr_pair<control_block_type, T>(m_cb, get()));
+        return ret;
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<T*, U*>>>
+    operator basic_shared_ptr<CBF, U>() && noexcept {
+        basic_shared_ptr<CBF, U> ret;
+        if (!m_cb) return ret;
+        ret.m = cb_ptr_pair<control_block_type, T>(m_cb, get());
+        m_cb->transfer_strong(&ret, this);
+        m_cb = nullptr;
+        return ret;
+    }
+
+    [[nodiscard]] shared_type to_shared() const& noexcept { return *this; }
+    [[nodiscard]] shared_type to_shared() && noexcept { return std::move(*this); }
+
+private:
+    void init_from_copy(control_block_type* cb) noexcept {
+        m_cb = cb;
+        if (m_cb) m_cb->inc_strong_ref(this);
+    }
+
+    template <typename U>
+    void init_from_move(basic_thin_shared_ptr<CBF, U>& r) noexcept {
+        m_cb = r.m_cb;
+        r.m_cb = nullptr;
+        if (m_cb) m_cb->transfer_strong(this, &r);
+    }
+
+    control_block_type* m_cb;
+
+    template <typename, typename> friend class basic_thin_shared_ptr;
+};
+
+// compare
+template <typename CBF1, typename T1, typename CBF2, typename T2>
+[[nodiscard]] bool operator==(const basic_thin_shared_ptr<CBF1, T1>& s1, const basic_thin_shared_ptr<CBF2, T2>& s2) { return s1.owner() == s2.owner(); }
+template <typename CBF1, typename T1, typename CBF2, typename T2>
+[[nodiscard]] bool operator!=(const basic_thin_shared_ptr<CBF1, T1>& s1, const basic_thin_shared_ptr<CBF2, T2>& s2) { return s1.owner() != s2.owner(); }
+template <typename CBF1, typename T1, typename CBF2, typename T2>
+[[nodiscard]] bool operator<(const basic_thin_shared_ptr<CBF1, T1>& s1, const basic_thin_shared_ptr<CBF2, T2>& s2) { return s1.owner() < s2.owner(); }
+
+template <typename CBF, typename T>
+[[nodiscard]] bool no_owner(const basic_thin_shared_ptr<CBF, T>& ptr) { return !ptr.owner(); }
+
+template <typename CBF, typename T1, typename T2>
+[[nodiscard]] bool same_owner(const basic_thin_shared_ptr<CBF, T1>& s1, const basic_thin_shared_ptr<CBF, T2>& s2) {
+    return s1.owner() == s2.owner();
+}
+template <typename CBF, typename T1, typename T2>
+[[nodiscard]] bool same_owner(const basic_thin_shared_ptr<CBF, T1>& s1, const basic_shared_ptr<CBF, T2>& s2) {
+    return s1.owner() == s2.owner();
+}
+template <typename CBF, typename T1, typename T2>
+[[nodiscard]] bool same_owner(const basic_shared_ptr<CBF, T1>& s1, const basic_thin_shared_ptr<CBF, T2>& s2) {
+    return s1.owner() == s2.owner();
+}
+
+} // namespace xmem
+
+// hashing by owner is equivalent to hashing by object, since there are no aliases
+namespace std {
+template <typename CBF, typename T>
+struct hash<xmem::basic_thin_shared_ptr<CBF, T>> {
+    size_t operator()(const xmem::basic_thin_shared_ptr<CBF, T>& ptr) const noexcept {
+        return hash<const void*>{}(ptr.owner());
+    }
+};
+}
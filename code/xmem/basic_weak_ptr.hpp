@@ -72,7 +72,7 @@ public:
     }
 
     template <typename U>
-    basic_weak_ptr(const basic_weak_ptr<CBF, U>& r, T* aptr) noexcept {
+    basic_weak_ptr(const basic_weak_ptr<CBF, U>& r, element_type* aptr) noexcept {
         if (!r) {
             m.reset();
             return;
@@ -80,7 +80,7 @@ public:
         init_from_copy(cb_ptr_pair_type(r.m.cb, aptr));
     }
     template <typename U>
-    basic_weak_ptr(const basic_shared_ptr<CBF, U>& sptr, T* aptr) noexcept {
+    basic_weak_ptr(const basic_shared_ptr<CBF, U>& sptr, element_type* aptr) noexcept {
         if (!sptr.m.cb) {
             m.reset();
             return;
@@ -162,6 +162,8 @@ private:
     cb_ptr_pair_type m;
 
     template <typename, typename> friend class basic_weak_ptr;
+    template <typename> friend struct relocation_traits;
+    template <typename, typename> friend class basic_weak_ptr_vector;
 };
 
 template <typename CBF, typename T>
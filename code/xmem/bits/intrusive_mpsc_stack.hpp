@@ -0,0 +1,43 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include <atomic>
+
+namespace xmem::impl {
+
+// A lock-free intrusive stack which any thread can push to, and whose consumers take all nodes at once
+// Node must have a `Node* next` member accessible to the stack
+template <typename Node>
+class intrusive_mpsc_stack {
+    std::atomic<Node*> m_head = {nullptr};
+public:
+    // returns true if the stack was empty
+    bool push(Node* n) noexcept {
+        auto head = m_head.load(std::memory_order_relaxed);
+        do {
+            n->next = head;
+        } while (!m_head.compare_exchange_weak(head, n, std::memory_order_release, std::memory_order_relaxed));
+        return !head;
+    }
+
+    // take all nodes in the order in which they were pushed
+    // returns a null-terminated list
+    [[nodiscard]] Node* take_all() noexcept {
+        auto n = m_head.exchange(nullptr, std::memory_order_acquire);
+        Node* ret = nullptr;
+        while (n) {
+            auto next = n->next;
+            n->next = ret;
+            ret = n;
+            n = next;
+        }
+        return ret;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return !m_head.load(std::memory_order_relaxed);
+    }
+};
+
+}
@@ -0,0 +1,24 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace xmem::impl {
+
+// the number of bits needed to index num_shards (rounded up to a power of two)
+inline unsigned shard_bits(unsigned num_shards) noexcept {
+    unsigned bits = 0;
+    while ((1u << bits) < num_shards) ++bits;
+    return bits;
+}
+
+// the shard of a hash
+// hashes may be poor in the high bits (or the identity), so it's mixed first
+inline size_t shard_index(uint64_t hash, unsigned bits) noexcept {
+    if (!bits) return 0;
+    return size_t((hash * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+}
+
+}
@@ -0,0 +1,255 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "spinlock.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace xmem::impl {
+
+// Fixed size classes of small blocks
+// Memory is carved from large chunks which come from a chunk source and are never returned to it
+// Free blocks are cached per thread and exchanged with a shared depot in batches
+// A chunk source is a type with a static function `void* allocate_chunk(size_t size)`
+// (chunks are a multiple of 16 bytes and must be aligned to at least 16)
+struct size_classes {
+    static inline constexpr size_t granularity = 16;
+    static inline constexpr size_t max_size = 512;
+    static inline constexpr size_t count = max_size / granularity;
+    static inline constexpr size_t chunk_size = 64 * 1024;
+
+    static constexpr bool fits(size_t size, size_t align) noexcept {
+        return size <= max_size && align <= granularity;
+    }
+    static constexpr size_t index_of(size_t size) noexcept {
+        return size ? (size - 1) / granularity : 0;
+    }
+    static constexpr size_t block_size(size_t index) noexcept {
+        return (index + 1) * granularity;
+    }
+    static constexpr uint32_t batch_size(size_t index) noexcept {
+        auto b = 4096 / block_size(index);
+        return uint32_t(b < 8 ? 8 : b > 64 ? 64 : b);
+    }
+};
+
+struct free_block {
+    free_block* next;
+    free_block* next_batch; // only valid for the head of a batch in the depot
+};
+
+struct free_chain {
+    free_block* head = nullptr;
+    uint32_t count = 0;
+};
+
+struct new_chunk_source {
+    // the default new alignment can be 8, so ask for the granularity explicitly
+    // (chunks are never freed, so there is no matching delete)
+    static void* allocate_chunk(size_t size) {
+        return ::operator new(size, std::align_val_t{size_classes::granularity});
+    }
+};
+
+// shared between threads, guarded by a spinlock per class
+template <typename ChunkSource>
+class size_class_depot {
+    struct alignas(cache_line_size) bin {
+        spinlock lock;
+        free_block* batches = nullptr; // each has exactly batch_size blocks
+        free_chain loose; // fewer than batch_size blocks returned one by one
+    };
+    bin m_bins[size_classes::count];
+
+    static free_chain carve(size_t index) {
+        auto bsize = size_classes::block_size(index);
+        auto batch = size_classes::batch_size(index);
+        auto per_chunk = size_classes::chunk_size / (bsize * batch);
+        auto nblocks = batch * (per_chunk ? per_chunk : 1);
+        auto buf = static_cast<char*>(ChunkSource::allocate_chunk(nblocks * bsize));
+        free_chain ret;
+        for (size_t i = nblocks; i-- > 0; ) {
+            auto b = reinterpret_cast<free_block*>(buf + i * bsize);
+            b->next = ret.head;
+            ret.head = b;
+        }
+        ret.count = uint32_t(nblocks);
+        return ret;
+    }
+public:
+    // returns at least one block
+    free_chain take(size_t index) {
+        auto& b = m_bins[index];
+        {
+            spinlock::lock_guard _l(b.lock);
+            if (b.batches) {
+                free_chain ret = {b.batches, size_classes::batch_size(index)};
+                b.batches = b.batches->next_batch;
+                return ret;
+            }
+            if (b.loose.head) {
+                free_chain ret = b.loose;
+                b.loose = {};
+                return ret;
+            }
+        }
+        auto fresh = carve(index);
+        // keep one batch for the caller and give the rest to the depot
+        auto batch = size_classes::batch_size(index);
+        free_block* tail = fresh.head;
+        for (uint32_t i = 1; i < batch; ++i) tail = tail->next;
+        auto rest = tail->next;
+        tail->next = nullptr;
+        if (rest) give_blocks(index, rest, fresh.count - batch);
+        return {fresh.head, batch};
+    }
+
+    // give a batch of exactly batch_size blocks
+    void give_batch(size_t index, free_block* head) noexcept {
+        auto& b = m_bins[index];
+        spinlock::lock_guard _l(b.lock);
+        head->next_batch = b.batches;
+        b.batches = head;
+    }
+
+    // give a null-terminated chain of count blocks, where count is a multiple of batch_size
+    void give_blocks(size_t index, free_block* head, size_t count) noexcept {
+        auto batch = size_classes::batch_size(index);
+        while (count) {
+            auto next = head;
+            for (uint32_t i = 0; i < batch; ++i) {
+                auto cur = next;
+                next = next->next;
+                if (i == batch - 1) cur->next = nullptr;
+            }
+            give_batch(index, head);
+            head = next;
+            count -= batch;
+        }
+    }
+
+    // give a single block (from threads which have no cache)
+    void give_one(size_t index, free_block* block) noexcept {
+        auto& b = m_bins[index];
+        spinlock::lock_guard _l(b.lock);
+        block->next = b.loose.head;
+        b.loose.head = block;
+        if (++b.loose.count == size_classes::batch_size(index)) {
+            block->next_batch = b.batches;
+            b.batches = block;
+            b.loose = {};
+        }
+    }
+
+    // leaked: thread caches may return blocks to it during static destruction
+    static size_class_depot& instance() {
+        static size_class_depot* the_depot = new size_class_depot;
+        return *the_depot;
+    }
+};
+
+// per-thread cache of free blocks
+// it's trivially destructible, so that it's still usable from other thread_local destructors
+// a separate guard flushes it to the depot on thread exit
+template <typename ChunkSource>
+struct size_class_thread_cache {
+    using depot = size_class_depot<ChunkSource>;
+
+    free_chain bins[size_classes::count];
+    bool dead = false;
+
+    void flush(size_t index) noexcept {
+        auto& d = depot::instance();
+        auto& bin = bins[index];
+        while (bin.head) {
+            auto block = bin.head;
+            bin.head = block->next;
+            d.give_one(index, block);
+        }
+        bin.count = 0;
+    }
+
+    struct guard {
+        size_class_thread_cache& cache;
+        ~guard() {
+            for (size_t i = 0; i < size_classes::count; ++i) {
+                cache.flush(i);
+            }
+            cache.dead = true;
+        }
+    };
+
+    static size_class_thread_cache& local() noexcept {
+        thread_local size_class_thread_cache the_cache;
+        return the_cache;
+    }
+    static size_class_thread_cache* local_alive() noexcept {
+        auto& cache = local();
+        if (cache.dead) return nullptr;
+        thread_local guard the_guard{cache};
+        (void)the_guard;
+        return &cache;
+    }
+};
+
+template <typename ChunkSource>
+void* size_class_allocate(size_t size) {
+    using cache_type = size_class_thread_cache<ChunkSource>;
+    using depot = typename cache_type::depot;
+    auto index = size_classes::index_of(size);
+    auto cache = cache_type::local_alive();
+    if (!cache) {
+        // thread is exiting
+        auto chain = depot::instance().take(index);
+        auto ret = chain.head;
+        chain.head = ret->next;
+        // return what's left
+        while (chain.head) {
+            auto b = chain.head;
+            chain.head = b->next;
+            depot::instance().give_one(index, b);
+        }
+        return ret;
+    }
+    auto& bin = cache->bins[index];
+    if (!bin.head) {
+        bin = depot::instance().take(index);
+    }
+    auto ret = bin.head;
+    bin.head = ret->next;
+    --bin.count;
+    return ret;
+}
+
+template <typename ChunkSource>
+void size_class_deallocate(void* ptr, size_t size) noexcept {
+    using cache_type = size_class_thread_cache<ChunkSource>;
+    using depot = typename cache_type::depot;
+    auto index = size_classes::index_of(size);
+    auto block = static_cast<free_block*>(ptr);
+    auto cache = cache_type::local_alive();
+    if (!cache) {
+        depot::instance().give_one(index, block);
+        return;
+    }
+    auto& bin = cache->bins[index];
+    block->next = bin.head;
+    bin.head = block;
+    auto batch = size_classes::batch_size(index);
+    if (++bin.count >= 2 * batch) {
+        // return a batch to the depot, so blocks freed by a thread which doesn't allocate them
+        // (a consumer) can get back to the producer
+        auto tail = bin.head;
+        for (uint32_t i = 1; i < batch; ++i) tail = tail->next;
+        auto ret = bin.head;
+        bin.head = tail->next;
+        tail->next = nullptr;
+        bin.count -= batch;
+        depot::instance().give_batch(index, ret);
+    }
+}
+
+}
@@ -0,0 +1,49 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "basic_shared_ptr.hpp"
+#include "basic_weak_ptr.hpp"
+#include "bits/prefetch.hpp"
+
+#include <cstddef>
+
+namespace xmem {
+
+// Operations on many pointers at once
+// Pointers to random objects have their control blocks all over memory, so touching them one after
+// the other is dominated by cache misses. These prefetch the control block of the pointer which is
+// prefetch_distance elements ahead of the current one.
+
+inline constexpr size_t default_prefetch_distance = 8;
+
+// reset n shared pointers
+template <typename CBF, typename T>
+void reset_all(basic_shared_ptr<CBF, T>* ptrs, size_t n, size_t prefetch_distance = default_prefetch_distance) noexcept {
+    for (size_t i = 0; i < n; ++i) {
+        if (i + prefetch_distance < n) {
+            impl::prefetch_for_write(ptrs[i + prefetch_distance].t_owner());
+        }
+        ptrs[i].reset();
+    }
+}
+
+// lock n weak pointers and write the non-expired results densely to out (which must have room for n)
+// returns the number of written pointers
+// out[i] for i >= the result is unchanged, except for out[result] which may be reset
+template <typename CBF, typename T>
+size_t lock_all(const basic_weak_ptr<CBF, T>* weak, size_t n, basic_shared_ptr<CBF, T>* out, size_t prefetch_distance = default_prefetch_distance) noexcept {
+    size_t ret = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (i + prefetch_distance < n) {
+            impl::prefetch_for_write(weak[i + prefetch_distance].t_owner());
+        }
+        // no branch on expiry: an expired result is overwritten by the next one
+        // a lock of an alias to null is not expired, so check the owner instead of the pointer
+        out[ret] = weak[i].lock();
+        ret += out[ret].t_owner() != nullptr;
+    }
+    return ret;
+}
+
+}
@@ -0,0 +1,154 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <new>
+
+#if !defined(XMEM_BUMP_ARENA_TRACK_LIVE)
+#   if defined(NDEBUG)
+#       define XMEM_BUMP_ARENA_TRACK_LIVE 0
+#   else
+#       define XMEM_BUMP_ARENA_TRACK_LIVE 1
+#   endif
+#endif
+
+namespace xmem {
+
+// A single-threaded bump allocator for memory with a common lifetime (say of a request)
+// Deallocating individual blocks is a no-op. All memory is reclaimed at once with reset()
+// The arena counts the blocks which haven't been deallocated. With XMEM_BUMP_ARENA_TRACK_LIVE
+// (default in debug builds) it asserts that there are none on reset and destruction.
+// The macro only affects the check, so the layout of the arena is the same either way.
+class bump_arena {
+public:
+    explicit bump_arena(size_t chunk_size = 64 * 1024) noexcept : m_chunk_size(chunk_size) {}
+    ~bump_arena() {
+        check_no_live();
+        free_chunks(nullptr);
+    }
+
+    bump_arena(const bump_arena&) = delete;
+    bump_arena& operator=(const bump_arena&) = delete;
+
+    [[nodiscard]] void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        auto p = align_up(m_top, align);
+        if (!m_head || p + size > m_end) {
+            new_chunk(size + align);
+            p = align_up(m_top, align);
+        }
+        m_top = p + size;
+        ++m_live;
+        return reinterpret_cast<void*>(p);
+    }
+
+    void deallocate(void*, size_t) noexcept {
+#if XMEM_BUMP_ARENA_TRACK_LIVE
+        assert(m_live > 0);
+#endif
+        --m_live;
+    }
+
+    // reclaim all memory, keeping the last chunk for reuse
+    void reset() noexcept {
+        check_no_live();
+        if (!m_head) return;
+        free_chunks(m_head);
+        m_head->prev = nullptr;
+        m_top = data_of(m_head);
+    }
+
+    // bytes allocated since the last reset (including padding)
+    [[nodiscard]] size_t used() const noexcept {
+        size_t ret = 0;
+        for (auto c = m_head; c; c = c->prev) {
+            ret += (c == m_head ? m_top : c->end) - data_of(c);
+        }
+        return ret;
+    }
+
+    // number of blocks which haven't been deallocated
+    [[nodiscard]] size_t live() const noexcept { return m_live; }
+
+private:
+    struct chunk {
+        chunk* prev;
+        uintptr_t end;
+    };
+
+    static uintptr_t align_up(uintptr_t p, size_t align) noexcept {
+        return (p + align - 1) & ~uintptr_t(align - 1);
+    }
+    static uintptr_t data_of(const chunk* c) noexcept {
+        return reinterpret_cast<uintptr_t>(c + 1);
+    }
+
+    void new_chunk(size_t min_size) {
+        auto size = sizeof(chunk) + (min_size > m_chunk_size ? min_size : m_chunk_size);
+        auto c = static_cast<chunk*>(::operator new(size));
+        c->prev = m_head;
+        c->end = reinterpret_cast<uintptr_t>(c) + size;
+        if (m_head) m_head->end = m_top; // only what's used counts
+        m_head = c;
+        m_top = data_of(c);
+        m_end = c->end;
+    }
+
+    // free all chunks before keep
+    void free_chunks(chunk* keep) noexcept {
+        auto c = keep ? keep->prev : m_head;
+        while (c) {
+            auto prev = c->prev;
+            ::operator delete(c);
+            c = prev;
+        }
+        if (!keep) m_head = nullptr;
+    }
+
+    void check_no_live() const noexcept {
+#if XMEM_BUMP_ARENA_TRACK_LIVE
+        assert(m_live == 0 && "blocks outlive the bump arena");
+#endif
+    }
+
+    size_t m_chunk_size;
+    chunk* m_head = nullptr;
+    uintptr_t m_top = 0;
+    uintptr_t m_end = 0;
+    size_t m_live = 0;
+};
+
+// An allocator which allocates from a bump arena
+// Control blocks allocated with it have their objects destroyed as usual, but their memory
+// is only reclaimed when the arena is reset
+template <typename T>
+class arena_allocator {
+public:
+    using value_type = T;
+
+    explicit arena_allocator(bump_arena& arena) noexcept : m_arena(&arena) {}
+    arena_allocator(const arena_allocator&) noexcept = default;
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept : m_arena(&other.arena()) {}
+
+    [[nodiscard]] T* allocate(size_t n) {
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* ptr, size_t n) noexcept {
+        m_arena->deallocate(ptr, n * sizeof(T));
+    }
+
+    [[nodiscard]] bump_arena& arena() const noexcept { return *m_arena; }
+
+    template <typename U>
+    bool operator==(const arena_allocator<U>& other) const noexcept { return m_arena == &other.arena(); }
+    template <typename U>
+    bool operator!=(const arena_allocator<U>& other) const noexcept { return m_arena != &other.arena(); }
+
+private:
+    bump_arena* m_arena;
+};
+
+}
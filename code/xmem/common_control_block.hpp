@@ -5,11 +5,26 @@
 #include "allocator_rebind.hpp"
 #include "basic_shared_from.hpp"
 #include "allocator.hpp"
+#include "trailing_span.hpp"
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#if !defined(XMEM_ITERATIVE_DESTRUCTION)
+#   define XMEM_ITERATIVE_DESTRUCTION 0
+#endif
 
 namespace xmem {
 
+// With XMEM_ITERATIVE_DESTRUCTION final releases which happen while an object is being destroyed on
+// the same thread (say the next node of a list) are queued in a thread-local worklist, which the
+// outermost release processes in a loop. Thus destroying deep structures doesn't recurse.
+// It costs a pointer per control block and must be the same for the entire program.
 template <typename RC>
 class control_block_base {
+protected:
     RC m_strong;
     RC m_weak;
 public:
@@ -20,8 +35,13 @@ public:
     }
     void dec_strong_ref(const void* src) noexcept {
         if (m_strong.dec() == 0) {
+#if XMEM_ITERATIVE_DESTRUCTION
+            (void)src;
+            release_iteratively();
+#else
             destroy_resource();
             dec_weak_ref(src);
+#endif
         }
     }
     bool inc_strong_ref_nz(const void*) noexcept {
@@ -31,7 +51,14 @@ public:
         return long(m_strong.count());
     }
     void transfer_strong(const void*, const void*) {}
+    // transfer the refs of n holders at dest and src, which are stride bytes apart (say a relocated range)
+    // control blocks which override transfer_strong must override this too
+    void transfer_strong_n(const void*, const void*, size_t /*n*/, size_t /*stride*/) {}
 
+    // while there are strong refs, they hold a single weak ref
+    long weak_ref_count() const noexcept {
+        return long(m_weak.count());
+    }
     void inc_weak_ref(const void*) noexcept {
         m_weak.inc();
     }
@@ -41,10 +68,44 @@ public:
         }
     }
     void transfer_weak(const void*, const void*) {}
+    void transfer_weak_n(const void*, const void*, size_t /*n*/, size_t /*stride*/) {}
 
 protected:
     virtual void destroy_resource() noexcept = 0;
     virtual void destroy_self() noexcept = 0;
+
+#if XMEM_ITERATIVE_DESTRUCTION
+private:
+    control_block_base* m_next_release = nullptr;
+
+    struct release_worklist {
+        control_block_base* head = nullptr;
+        bool active = false;
+    };
+    static release_worklist& worklist() noexcept {
+        thread_local release_worklist the_worklist;
+        return the_worklist;
+    }
+
+    void release_iteratively() noexcept {
+        auto& wl = worklist();
+        if (wl.active) {
+            // we're in a destructor: leave it to the loop below
+            m_next_release = wl.head;
+            wl.head = this;
+            return;
+        }
+        wl.active = true;
+        auto cb = this;
+        while (cb) {
+            cb->destroy_resource();
+            cb->dec_weak_ref(cb);
+            cb = wl.head;
+            if (cb) wl.head = cb->m_next_release;
+        }
+        wl.active = false;
+    }
+#endif
 };
 
 template <typename Base, typename T, typename Alloc>
@@ -83,12 +144,360 @@ public:
     }
 };
 
+// a control block which allocates the object separately
+// the object's memory is freed as soon as the object is destroyed, so weak pointers only keep the control block alive
+template <typename Base, typename T, typename Alloc>
+class control_block_split_resource final : public Base, private /*EBO*/ Alloc {
+    T* m_obj = nullptr;
+
+    using self_alloc_type = typename allocator_rebind<Alloc>::template to<control_block_split_resource>;
+    using obj_alloc_type = typename allocator_rebind<Alloc>::template to<T>;
+
+    static self_alloc_type get_self_alloc(const Alloc& a) {
+        self_alloc_type myalloc = a;
+        return myalloc;
+    }
+    obj_alloc_type get_obj_alloc() const {
+        obj_alloc_type myalloc = static_cast<const Alloc&>(*this);
+        return myalloc;
+    }
+
+    explicit control_block_split_resource(Alloc&& a) : Alloc(std::move(a)) {}
+    ~control_block_split_resource() {}
+public:
+    using control_block_resource_ptr = unique_ptr<control_block_split_resource, void(*)(control_block_split_resource*)>;
+
+    // allocates the control block only
+    [[nodiscard]] static control_block_resource_ptr create(Alloc a) {
+        auto myalloc = get_self_alloc(a);
+        auto self = myalloc.allocate(1);
+        new (self) control_block_split_resource(std::move(a));
+        return control_block_resource_ptr(self, [](control_block_split_resource* ptr) { ptr->destroy_self(); });
+    }
+
+    // allocate the object and construct it with a functor which constructs it in place
+    template <typename Construct>
+    void construct(Construct&& construct) {
+        auto oalloc = get_obj_alloc();
+        auto obj = oalloc.allocate(1);
+        try {
+            construct(obj);
+        }
+        catch (...) {
+            oalloc.deallocate(obj, 1);
+            throw;
+        }
+        m_obj = obj;
+    }
+
+    [[nodiscard]] T* obj() noexcept {
+        return m_obj;
+    }
+
+    virtual void destroy_resource() noexcept override {
+        m_obj->~T();
+        get_obj_alloc().deallocate(m_obj, 1);
+        m_obj = nullptr;
+    }
+    virtual void destroy_self() noexcept override {
+        self_alloc_type myalloc = get_self_alloc(*this); // slice
+        this->~control_block_split_resource();
+        myalloc.deallocate(this, 1);
+    }
+};
+
+#if !defined(XMEM_SPLIT_ALLOCATION_THRESHOLD)
+#   define XMEM_SPLIT_ALLOCATION_THRESHOLD (64 * 1024)
+#endif
+
+// whether make_shared allocates the object separately from the control block
+// by default this is done for objects of at least XMEM_SPLIT_ALLOCATION_THRESHOLD bytes, as it's a small
+// price compared to such an object being kept allocated by weak pointers
+// specialize for types which need a different policy
+template <typename T>
+struct split_allocation : std::bool_constant<(sizeof(T) >= XMEM_SPLIT_ALLOCATION_THRESHOLD)> {};
+
+namespace impl {
+// allocation unit for control blocks with a size known only at runtime
+template <size_t Align>
+struct alignas(Align) cb_alloc_unit {
+    unsigned char bytes[Align];
+};
+
+constexpr size_t align_up(size_t size, size_t align) noexcept {
+    return (size + align - 1) / align * align;
+}
+
+template <typename... Ts>
+inline constexpr size_t max_align_of = std::max({alignof(Ts)...});
+
+// throw if a header of offset bytes followed by n elements of elem_size bytes (rounded up to
+// allocation units of unit_size) doesn't fit in size_t
+inline void check_runtime_size(size_t offset, size_t n, size_t elem_size, size_t unit_size) {
+    if (n > (SIZE_MAX - offset - (unit_size - 1)) / elem_size) throw std::bad_array_new_length();
+}
+}
+
+// a control block followed by a runtime-sized array of objects in the same allocation
+template <typename Base, typename T, typename Alloc>
+class control_block_array_resource final : public Base, private /*EBO*/ Alloc {
+    size_t m_size;
+
+    static constexpr size_t align = impl::max_align_of<Base, Alloc, size_t, T>;
+    using unit_type = impl::cb_alloc_unit<align>;
+    using unit_alloc_type = typename allocator_rebind<Alloc>::template to<unit_type>;
+
+    static unit_alloc_type get_unit_alloc(const Alloc& a) {
+        unit_alloc_type myalloc = a;
+        return myalloc;
+    }
+
+    static size_t elements_offset() noexcept {
+        return impl::align_up(sizeof(control_block_array_resource), alignof(T));
+    }
+    static size_t units_for(size_t n) noexcept {
+        return (elements_offset() + n * sizeof(T) + sizeof(unit_type) - 1) / sizeof(unit_type);
+    }
+
+    control_block_array_resource(Alloc&& a, size_t n) : Alloc(std::move(a)), m_size(n) {}
+    ~control_block_array_resource() {}
+public:
+    using control_block_resource_ptr = unique_ptr<control_block_array_resource, void(*)(control_block_array_resource*)>;
+
+    // allocates, but doesn't construct the elements
+    // throws std::bad_array_new_length if the size of the allocation overflows
+    [[nodiscard]] static control_block_resource_ptr create(Alloc a, size_t n) {
+        impl::check_runtime_size(elements_offset(), n, sizeof(T), sizeof(unit_type));
+        auto myalloc = get_unit_alloc(a);
+        auto self = reinterpret_cast<control_block_array_resource*>(myalloc.allocate(units_for(n)));
+        new (self) control_block_array_resource(std::move(a), n);
+        return control_block_resource_ptr(self, [](control_block_array_resource* ptr) { ptr->destroy_self(); });
+    }
+
+    // construct elements with a functor which constructs a single element in place
+    // if an element constructor throws, the ones constructed so far are destroyed
+    template <typename Construct>
+    void construct_elements(Construct&& construct) {
+        auto elems = obj();
+        size_t i = 0;
+        try {
+            for (; i < m_size; ++i) {
+                construct(elems + i);
+            }
+        }
+        catch (...) {
+            while (i-- > 0) elems[i].~T();
+            throw;
+        }
+    }
+
+    [[nodiscard]] T* obj() noexcept {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + elements_offset());
+    }
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+
+    virtual void destroy_resource() noexcept override {
+        auto elems = obj();
+        for (size_t i = m_size; i-- > 0; ) elems[i].~T();
+    }
+    virtual void destroy_self() noexcept override {
+        unit_alloc_type myalloc = get_unit_alloc(*this); // slice
+        auto units = units_for(m_size);
+        this->~control_block_array_resource();
+        myalloc.deallocate(reinterpret_cast<unit_type*>(this), units);
+    }
+};
+
+// a control block with an object, followed by a runtime-sized array of trailing elements in the same allocation
+// the object is constructed with a trailing_span of the elements as its first argument
+template <typename Base, typename T, typename E, typename Alloc>
+class control_block_trailing_resource final : public Base, private /*EBO*/ Alloc {
+    union {
+        T m_obj;
+    };
+    size_t m_count;
+
+    static constexpr size_t align = impl::max_align_of<Base, Alloc, T, size_t, E>;
+    using unit_type = impl::cb_alloc_unit<align>;
+    using unit_alloc_type = typename allocator_rebind<Alloc>::template to<unit_type>;
+
+    static unit_alloc_type get_unit_alloc(const Alloc& a) {
+        unit_alloc_type myalloc = a;
+        return myalloc;
+    }
+
+    static size_t trailing_offset() noexcept {
+        return impl::align_up(sizeof(control_block_trailing_resource), alignof(E));
+    }
+    static size_t units_for(size_t n) noexcept {
+        return (trailing_offset() + n * sizeof(E) + sizeof(unit_type) - 1) / sizeof(unit_type);
+    }
+
+    control_block_trailing_resource(Alloc&& a, size_t n) : Alloc(std::move(a)), m_count(n) {}
+    ~control_block_trailing_resource() {}
+
+    void destroy_trailing(size_t n) noexcept {
+        auto elems = trailing().data();
+        while (n-- > 0) elems[n].~E();
+    }
+public:
+    using control_block_resource_ptr = unique_ptr<control_block_trailing_resource, void(*)(control_block_trailing_resource*)>;
+
+    // allocates, but doesn't construct anything
+    // throws std::bad_array_new_length if the size of the allocation overflows
+    [[nodiscard]] static control_block_resource_ptr create(Alloc a, size_t n) {
+        impl::check_runtime_size(trailing_offset(), n, sizeof(E), sizeof(unit_type));
+        auto myalloc = get_unit_alloc(a);
+        auto self = reinterpret_cast<control_block_trailing_resource*>(myalloc.allocate(units_for(n)));
+        new (self) control_block_trailing_resource(std::move(a), n);
+        return control_block_resource_ptr(self, [](control_block_trailing_resource* ptr) { ptr->destroy_self(); });
+    }
+
+    // value-initialize the trailing elements, then construct the object with (trailing(), args...)
+    template <typename... Args>
+    void construct(Args&&... args) {
+        auto elems = trailing().data();
+        size_t i = 0;
+        try {
+            for (; i < m_count; ++i) {
+                new (elems + i) E();
+            }
+            new (&m_obj) T(trailing(), std::forward<Args>(args)...);
+        }
+        catch (...) {
+            destroy_trailing(i);
+            throw;
+        }
+    }
+
+    [[nodiscard]] T* obj() noexcept {
+        return &m_obj;
+    }
+    [[nodiscard]] trailing_span<E> trailing() noexcept {
+        return {reinterpret_cast<E*>(reinterpret_cast<char*>(this) + trailing_offset()), m_count};
+    }
+
+    virtual void destroy_resource() noexcept override {
+        m_obj.~T();
+        destroy_trailing(m_count);
+    }
+    virtual void destroy_self() noexcept override {
+        unit_alloc_type myalloc = get_unit_alloc(*this); // slice
+        auto units = units_for(m_count);
+        this->~control_block_trailing_resource();
+        myalloc.deallocate(reinterpret_cast<unit_type*>(this), units);
+    }
+};
+
+// a slab of n independent control blocks with their objects in a single allocation
+// each slot has its own strong and weak refs and the slab is freed when the last slot is destroyed
+template <typename Base, typename T, typename Alloc>
+class control_block_slab final : private /*EBO*/ Alloc {
+public:
+    class slot final : public Base {
+        union {
+            T m_obj;
+        };
+        control_block_slab* m_slab;
+
+        friend class control_block_slab;
+        explicit slot(control_block_slab* slab) : m_slab(slab) {}
+        ~slot() {}
+    public:
+        [[nodiscard]] T* obj() noexcept {
+            return &m_obj;
+        }
+
+        virtual void destroy_resource() noexcept override { m_obj.~T(); }
+        virtual void destroy_self() noexcept override {
+            auto slab = m_slab;
+            this->~slot();
+            slab->release_slot();
+        }
+    };
+
+private:
+    // slots are destroyed independently, potentially from different threads
+    std::atomic_size_t m_live;
+    size_t m_size;
+
+    static constexpr size_t align = impl::max_align_of<Alloc, std::atomic_size_t, slot>;
+    using unit_type = impl::cb_alloc_unit<align>;
+    using unit_alloc_type = typename allocator_rebind<Alloc>::template to<unit_type>;
+
+    static size_t slots_offset() noexcept {
+        return impl::align_up(sizeof(control_block_slab), alignof(slot));
+    }
+    static size_t units_for(size_t n) noexcept {
+        return (slots_offset() + n * sizeof(slot) + sizeof(unit_type) - 1) / sizeof(unit_type);
+    }
+
+    control_block_slab(Alloc&& a, size_t n) : Alloc(std::move(a)), m_live(0), m_size(n) {}
+    ~control_block_slab() = default;
+
+    slot* slot_at(size_t i) noexcept {
+        return reinterpret_cast<slot*>(reinterpret_cast<char*>(this) + slots_offset()) + i;
+    }
+
+    void release_slot() noexcept {
+        if (m_live.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            free_slab();
+        }
+    }
+
+    void free_slab() noexcept {
+        unit_alloc_type myalloc = *this; // slice
+        auto units = units_for(m_size);
+        this->~control_block_slab();
+        myalloc.deallocate(reinterpret_cast<unit_type*>(this), units);
+    }
+public:
+    // allocate a slab and construct all slots, then call on_slot(slot*) for each of them
+    // if an object constructor throws, everything constructed so far is destroyed
+    // on_slot must not throw
+    // throws std::bad_array_new_length if the size of the allocation overflows
+    template <typename Construct, typename OnSlot>
+    static void create(Alloc a, size_t n, Construct&& construct, OnSlot&& on_slot) {
+        impl::check_runtime_size(slots_offset(), n, sizeof(slot), sizeof(unit_type));
+        unit_alloc_type myalloc = a;
+        auto self = reinterpret_cast<control_block_slab*>(myalloc.allocate(units_for(n)));
+        new (self) control_block_slab(std::move(a), n);
+        size_t i = 0;
+        try {
+            for (; i < n; ++i) {
+                auto s = new (self->slot_at(i)) slot(self);
+                try {
+                    construct(s->obj());
+                }
+                catch (...) {
+                    s->~slot();
+                    throw;
+                }
+            }
+        }
+        catch (...) {
+            while (i-- > 0) {
+                auto s = self->slot_at(i);
+                s->destroy_resource();
+                s->~slot();
+            }
+            self->free_slab();
+            throw;
+        }
+        self->m_live.store(n, std::memory_order_release);
+        for (i = 0; i < n; ++i) {
+            on_slot(self->slot_at(i));
+        }
+        if (n == 0) self->free_slab();
+    }
+};
+
 template <typename CB>
 struct control_block_factory {
     using cb_type = CB;
 
     template <typename T>
-    using pair = cb_ptr_pair<cb_type, T>;
+    using pair = cb_ptr_pair<cb_type, std::remove_extent_t<T>>;
 
     template <typename T>
     using sptr = basic_shared_ptr<control_block_factory, T>;
@@ -114,23 +523,144 @@ struct control_block_factory {
         return prepare_pair(cb, cb->obj()->get());
     }
 
+    // for arrays the elements are allocated in the control block:
+    // T[] takes (n) or (n, const elem&), and T[N] takes () or (const elem&)
     template <typename T, typename Alloc, typename... Args>
     [[nodiscard]] static pair<T> make_resource_cb(Alloc a, Args&&... args) {
-        using rsrc_type = control_block_resource<cb_type, T, Alloc>;
-        auto tmp = rsrc_type::create(std::move(a));
-        new (tmp->obj()) T(std::forward<Args>(args)...);
-        auto cb = tmp.release();
-        return prepare_pair(cb, cb->obj());
+        if constexpr (std::is_array_v<T>) {
+            return make_array_cb<T>(std::move(a), std::forward<Args>(args)...);
+        }
+        else if constexpr (split_allocation<T>::value) {
+            return make_split_resource_cb<T>(std::move(a), std::forward<Args>(args)...);
+        }
+        else {
+            using rsrc_type = control_block_resource<cb_type, T, Alloc>;
+            auto tmp = rsrc_type::create(std::move(a));
+            new (tmp->obj()) T(std::forward<Args>(args)...);
+            auto cb = tmp.release();
+            return prepare_pair(cb, cb->obj());
+        }
     }
 
     template <typename T, typename Alloc>
     [[nodiscard]] static pair<T> make_resource_cb_for_overwrite(Alloc a) {
-        using rsrc_type = control_block_resource<cb_type, T, Alloc>;
+        if constexpr (std::is_array_v<T>) {
+            static_assert(std::extent_v<T> != 0, "unbounded arrays require a size");
+            return make_array_cb_for_overwrite<T>(std::move(a), std::extent_v<T>);
+        }
+        else if constexpr (split_allocation<T>::value) {
+            using rsrc_type = control_block_split_resource<cb_type, T, Alloc>;
+            auto tmp = rsrc_type::create(std::move(a));
+            tmp->construct([](T* obj) { new (obj) T; });
+            auto cb = tmp.release();
+            return prepare_pair(cb, cb->obj());
+        }
+        else {
+            using rsrc_type = control_block_resource<cb_type, T, Alloc>;
+            auto tmp = rsrc_type::create(std::move(a));
+            new (tmp->obj()) T;
+            auto cb = tmp.release();
+            return prepare_pair(cb, cb->obj());
+        }
+    }
+
+    template <typename T, typename Alloc>
+    [[nodiscard]] static pair<T> make_resource_cb_for_overwrite(Alloc a, size_t n) {
+        static_assert(std::is_array_v<T> && std::extent_v<T> == 0, "only unbounded arrays take a size");
+        return make_array_cb_for_overwrite<T>(std::move(a), n);
+    }
+
+    // the object is allocated separately from the control block (regardless of split_allocation)
+    template <typename T, typename Alloc, typename... Args>
+    [[nodiscard]] static pair<T> make_split_resource_cb(Alloc a, Args&&... args) {
+        using rsrc_type = control_block_split_resource<cb_type, T, Alloc>;
         auto tmp = rsrc_type::create(std::move(a));
-        new (tmp->obj()) T;
+        tmp->construct([&](T* obj) { new (obj) T(std::forward<Args>(args)...); });
+        auto cb = tmp.release();
+        return prepare_pair(cb, cb->obj());
+    }
+
+    // n objects in a single control block, each constructed with args
+    // the returned pair points to the first one
+    template <typename T, typename Alloc, typename... Args>
+    [[nodiscard]] static pair<T> make_array_resource_cb(Alloc a, size_t n, const Args&... args) {
+        return make_array_resource_cb_with<T>(std::move(a), n, [&](T* elem) { new (elem) T(args...); });
+    }
+
+    // n objects in a single control block, each constructed in place by construct(T*)
+    template <typename T, typename Alloc, typename Construct>
+    [[nodiscard]] static pair<T> make_array_resource_cb_with(Alloc a, size_t n, Construct&& construct) {
+        using rsrc_type = control_block_array_resource<cb_type, T, Alloc>;
+        auto tmp = rsrc_type::create(std::move(a), n);
+        tmp->construct_elements(std::forward<Construct>(construct));
+        auto cb = tmp.release();
+        auto elems = cb->obj();
+        for (size_t i = 0; i < n; ++i) {
+            prepare_pair(cb, elems + i);
+        }
+        return {cb, elems};
+    }
+
+    // an object followed by count trailing elements in the same allocation
+    // the object is constructed with (trailing_span<E>, args...)
+    template <typename T, typename E, typename Alloc, typename... Args>
+    [[nodiscard]] static pair<T> make_trailing_resource_cb(Alloc a, size_t count, Args&&... args) {
+        using rsrc_type = control_block_trailing_resource<cb_type, T, E, Alloc>;
+        auto tmp = rsrc_type::create(std::move(a), count);
+        tmp->construct(std::forward<Args>(args)...);
         auto cb = tmp.release();
         return prepare_pair(cb, cb->obj());
     }
+
+    // n objects with independent control blocks in a single allocation (a slab)
+    // on_pair is called with the pair for each object and must not throw
+    template <typename T, typename Alloc, typename OnPair, typename... Args>
+    static void make_slab_resource_cbs(Alloc a, size_t n, OnPair&& on_pair, const Args&... args) {
+        using slab_type = control_block_slab<cb_type, T, Alloc>;
+        slab_type::create(std::move(a), n,
+            [&](T* obj) { new (obj) T(args...); },
+            [&](typename slab_type::slot* s) { on_pair(prepare_pair(s, s->obj())); }
+        );
+    }
+
+    // thin pointers: the object is always found in a control_block_resource with a known allocator type
+    template <typename T, typename Alloc = allocator<char>>
+    using thin_rsrc_type = control_block_resource<cb_type, std::remove_cv_t<T>, Alloc>;
+
+    template <typename T, typename Alloc = allocator<char>>
+    [[nodiscard]] static T* thin_obj(cb_type* cb) noexcept {
+        return static_cast<thin_rsrc_type<T, Alloc>*>(cb)->obj();
+    }
+
+    template <typename T, typename Alloc, typename... Args>
+    [[nodiscard]] static cb_type* make_thin_cb(Alloc a, Args&&... args) {
+        using rsrc_type = thin_rsrc_type<T, Alloc>;
+        auto tmp = rsrc_type::create(std::move(a));
+        new (tmp->obj()) std::remove_cv_t<T>(std::forward<Args>(args)...);
+        auto cb = tmp.release();
+        prepare_pair(cb, cb->obj());
+        return cb;
+    }
+
+private:
+    template <typename T, typename Alloc, typename... Args>
+    [[nodiscard]] static pair<T> make_array_cb(Alloc a, Args&&... args) {
+        using elem_type = std::remove_extent_t<T>;
+        static_assert(!std::is_array_v<elem_type>, "multidimensional arrays are not supported");
+        if constexpr (std::extent_v<T> == 0) {
+            return make_array_resource_cb<elem_type>(std::move(a), args...);
+        }
+        else {
+            return make_array_resource_cb<elem_type>(std::move(a), std::extent_v<T>, args...);
+        }
+    }
+
+    template <typename T, typename Alloc>
+    [[nodiscard]] static pair<T> make_array_cb_for_overwrite(Alloc a, size_t n) {
+        using elem_type = std::remove_extent_t<T>;
+        static_assert(!std::is_array_v<elem_type>, "multidimensional arrays are not supported");
+        return make_array_resource_cb_with<elem_type>(std::move(a), n, [](elem_type* elem) { new (elem) elem_type; });
+    }
 };
 
 
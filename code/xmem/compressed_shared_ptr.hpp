@@ -0,0 +1,43 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "shared_ptr.hpp"
+#include "local_shared_ptr.hpp"
+#include "basic_compressed_shared_ptr.hpp"
+
+namespace xmem {
+
+template <typename Domain, typename T>
+using compressed_shared_ptr = basic_compressed_shared_ptr<atomic_control_block_factory, Domain, T>;
+
+template <typename Domain, typename T>
+using compressed_thin_shared_ptr = basic_compressed_thin_shared_ptr<atomic_control_block_factory, Domain, T>;
+
+template <typename Domain, typename T, typename... Args>
+[[nodiscard]] compressed_shared_ptr<Domain, T> make_compressed_shared(Args&&... args) {
+    return compressed_shared_ptr<Domain, T>(atomic_control_block_factory::make_resource_cb<T>(offset_allocator<char, Domain>{}, std::forward<Args>(args)...));
+}
+
+template <typename Domain, typename T, typename... Args>
+[[nodiscard]] compressed_thin_shared_ptr<Domain, T> make_compressed_thin_shared(Args&&... args) {
+    return compressed_thin_shared_ptr<Domain, T>(atomic_control_block_factory::make_thin_cb<T>(offset_allocator<char, Domain>{}, std::forward<Args>(args)...));
+}
+
+template <typename Domain, typename T>
+using local_compressed_shared_ptr = basic_compressed_shared_ptr<local_control_block_factory, Domain, T>;
+
+template <typename Domain, typename T>
+using local_compressed_thin_shared_ptr = basic_compressed_thin_shared_ptr<local_control_block_factory, Domain, T>;
+
+template <typename Domain, typename T, typename... Args>
+[[nodiscard]] local_compressed_shared_ptr<Domain, T> make_local_compressed_shared(Args&&... args) {
+    return local_compressed_shared_ptr<Domain, T>(local_control_block_factory::make_resource_cb<T>(offset_allocator<char, Domain>{}, std::forward<Args>(args)...));
+}
+
+template <typename Domain, typename T, typename... Args>
+[[nodiscard]] local_compressed_thin_shared_ptr<Domain, T> make_local_compressed_thin_shared(Args&&... args) {
+    return local_compressed_thin_shared_ptr<Domain, T>(local_control_block_factory::make_thin_cb<T>(offset_allocator<char, Domain>{}, std::forward<Args>(args)...));
+}
+
+}
@@ -0,0 +1,76 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "unique_ptr.hpp"
+#include "cb_ptr_pair.hpp"
+
+#include <cassert>
+
+namespace xmem {
+
+template <typename CBF, typename T>
+class basic_shared_ptr;
+
+// A unique_ptr deleter which owns a strong ref to a control block
+// The object of a unique_ptr with this deleter is already in a control block, so converting it to a
+// basic_shared_ptr with the same factory doesn't allocate (see make_unique_shareable)
+// Like basic_shared_ptr it makes sane transfer_strong calls when moved, using its own address as
+// the source
+// The deleter owns the control block, not the pointer, so the unique_ptr must keep the object it
+// was created with: reset(p) with a different pointer and release() are not supported. The first
+// leaves p without a control block, and the second leaks a ref to the control block (both assert).
+template <typename CBF>
+class control_block_deleter {
+public:
+    using control_block_type = typename CBF::cb_type;
+
+    control_block_deleter() noexcept = default;
+    ~control_block_deleter() {
+        assert(!m_cb && "the object of a unique shareable pointer was released");
+    }
+
+    control_block_deleter(control_block_deleter&& other) noexcept : m_cb(other.m_cb) {
+        other.m_cb = nullptr;
+        if (m_cb) m_cb->transfer_strong(this, &other);
+    }
+    control_block_deleter& operator=(control_block_deleter&& other) noexcept {
+        if (&other == this) return *this;
+        if (m_cb) m_cb->dec_strong_ref(this);
+        m_cb = other.m_cb;
+        other.m_cb = nullptr;
+        if (m_cb) m_cb->transfer_strong(this, &other);
+        return *this;
+    }
+
+    // the object is destroyed by the control block
+    template <typename T>
+    void operator()(T*) noexcept {
+        assert(m_cb && "the object of a unique shareable pointer is not in its control block");
+        auto cb = m_cb;
+        m_cb = nullptr;
+        if (cb) cb->dec_strong_ref(this);
+    }
+
+    [[nodiscard]] const control_block_type* t_owner() const noexcept { return m_cb; }
+
+    // take ownership of a newly created control block and object
+    template <typename T>
+    [[nodiscard]] static unique_ptr<T, control_block_deleter> make_unique(cb_ptr_pair<control_block_type, T>&& cbptr) noexcept {
+        unique_ptr<T, control_block_deleter> ret;
+        auto& d = ret.get_deleter();
+        d.m_cb = cbptr.cb;
+        if (d.m_cb) d.m_cb->init_strong(&d);
+        ret.reset(cbptr.ptr);
+        cbptr.reset();
+        return ret;
+    }
+
+private:
+    control_block_type* m_cb = nullptr;
+
+    template <typename, typename> friend class basic_shared_ptr;
+    template <typename> friend struct relocation_traits;
+};
+
+}
@@ -0,0 +1,195 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "common_control_block.hpp"
+#include "atomic_ref_count.hpp"
+#include "bits/intrusive_mpsc_stack.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace xmem {
+
+namespace impl {
+class reclaim_queue;
+}
+
+// A control block whose final strong release doesn't destroy the object, but pushes the block to a
+// global lock-free reclaim queue. Objects in the queue are destroyed by drain_reclaim_queue, which is
+// called explicitly or by a reclaimer_thread.
+// Weak pointers can't be locked while the object is waiting to be destroyed
+class deferred_control_block : public control_block_base<atomic_ref_count> {
+public:
+    void dec_strong_ref(const void*) noexcept;
+
+private:
+    deferred_control_block* next = nullptr;
+
+    // called by the reclaimer
+    void reclaim() noexcept {
+        destroy_resource();
+        dec_weak_ref(this);
+    }
+
+    friend class impl::intrusive_mpsc_stack<deferred_control_block>;
+    friend class impl::reclaim_queue;
+};
+
+struct reclaim_stats {
+    size_t pending; // objects waiting to be destroyed
+    size_t peak_pending; // the highest number of pending objects so far
+    size_t reclaimed; // objects destroyed so far
+};
+
+namespace impl {
+class reclaim_queue {
+public:
+    void push(deferred_control_block* cb) noexcept {
+        auto pending = m_pending.fetch_add(1, std::memory_order_relaxed) + 1;
+        auto peak = m_peak_pending.load(std::memory_order_relaxed);
+        while (pending > peak && !m_peak_pending.compare_exchange_weak(peak, pending, std::memory_order_relaxed));
+        m_stack.push(cb);
+    }
+
+    // destroy the objects which are currently queued
+    // (objects released by their destructors are queued for the next drain)
+    size_t drain() noexcept {
+        size_t ret = 0;
+        auto cb = m_stack.take_all();
+        while (cb) {
+            auto next = cb->next;
+            cb->reclaim();
+            cb = next;
+            ++ret;
+        }
+        m_pending.fetch_sub(ret, std::memory_order_relaxed);
+        m_reclaimed.fetch_add(ret, std::memory_order_relaxed);
+        return ret;
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return m_stack.empty(); }
+
+    [[nodiscard]] reclaim_stats stats() const noexcept {
+        return {
+            m_pending.load(std::memory_order_relaxed),
+            m_peak_pending.load(std::memory_order_relaxed),
+            m_reclaimed.load(std::memory_order_relaxed)
+        };
+    }
+
+    // leaked: objects may be released during static destruction
+    static reclaim_queue& instance() {
+        static reclaim_queue* the_queue = new reclaim_queue;
+        return *the_queue;
+    }
+
+private:
+    intrusive_mpsc_stack<deferred_control_block> m_stack;
+    std::atomic_size_t m_pending = {0};
+    std::atomic_size_t m_peak_pending = {0};
+    std::atomic_size_t m_reclaimed = {0};
+};
+}
+
+inline void deferred_control_block::dec_strong_ref(const void*) noexcept {
+    if (m_strong.dec() == 0) {
+        impl::reclaim_queue::instance().push(this);
+    }
+}
+
+// destroy the objects which are currently in the reclaim queue
+// returns the number of destroyed objects
+inline size_t drain_reclaim_queue() noexcept {
+    return impl::reclaim_queue::instance().drain();
+}
+
+// drain the reclaim queue until it's empty (including objects released by the destructors)
+// use on shutdown
+inline size_t flush_reclaim_queue() noexcept {
+    auto& q = impl::reclaim_queue::instance();
+    size_t ret = 0;
+    while (!q.empty()) {
+        ret += q.drain();
+    }
+    return ret;
+}
+
+[[nodiscard]] inline reclaim_stats get_reclaim_stats() noexcept {
+    return impl::reclaim_queue::instance().stats();
+}
+
+// A thread which drains the reclaim queue periodically
+// Producers don't signal it (this would cost them a lock), so objects wait for up to an interval
+// The queue is flushed when the thread is stopped
+class reclaimer_thread {
+public:
+    explicit reclaimer_thread(std::chrono::microseconds interval = std::chrono::milliseconds(1))
+        : m_interval(interval)
+        , m_thread([this]() { run(); })
+    {}
+    ~reclaimer_thread() {
+        stop();
+    }
+
+    reclaimer_thread(const reclaimer_thread&) = delete;
+    reclaimer_thread& operator=(const reclaimer_thread&) = delete;
+
+    void stop() {
+        if (!m_thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> _l(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> l(m_mutex);
+        while (!m_stop) {
+            l.unlock();
+            drain_reclaim_queue();
+            l.lock();
+            m_cv.wait_for(l, m_interval, [this]() { return m_stop; });
+        }
+        l.unlock();
+        flush_reclaim_queue();
+    }
+
+    std::chrono::microseconds m_interval;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop = false;
+    std::thread m_thread;
+};
+
+using deferred_control_block_factory = control_block_factory<deferred_control_block>;
+
+template <typename T>
+using deferred_shared_ptr = basic_shared_ptr<deferred_control_block_factory, T>;
+
+template <typename T>
+using deferred_weak_ptr = basic_weak_ptr<deferred_control_block_factory, T>;
+
+using enable_deferred_shared_from = basic_enable_shared_from<deferred_control_block_factory>;
+
+template <typename T>
+using enable_deferred_shared_from_this = basic_enable_shared_from_this<deferred_control_block_factory, T>;
+
+// the object will be destroyed by drain_reclaim_queue after the last strong ref to it is released
+template <typename T, typename... Args>
+[[nodiscard]] deferred_shared_ptr<T> make_deferred_shared(Args&&... args) {
+    return deferred_shared_ptr<T>(deferred_control_block_factory::make_resource_cb<T>(allocator<char>{}, std::forward<Args>(args)...));
+}
+
+template <typename T, typename Alloc, typename... Args>
+[[nodiscard]] deferred_shared_ptr<T> allocate_deferred_shared(const Alloc& a, Args&&... args) {
+    return deferred_shared_ptr<T>(deferred_control_block_factory::make_resource_cb<T>(a, std::forward<Args>(args)...));
+}
+
+}
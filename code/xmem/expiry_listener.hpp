@@ -0,0 +1,175 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "common_control_block.hpp"
+#include "atomic_ref_count.hpp"
+#include "local_ref_count.hpp"
+#include "bits/spinlock.hpp"
+
+#include <thread>
+
+namespace xmem {
+
+template <typename CB>
+class basic_expiry_listener;
+
+// A control block which notifies listeners when its object is destroyed
+// (right after destroy_resource, by the thread which releases the last strong ref)
+// Thus a cache of weak pointers can evict expired entries without scanning for them
+template <typename RC>
+class basic_expiry_control_block : public control_block_base<RC> {
+public:
+    using listener_type = basic_expiry_listener<basic_expiry_control_block>;
+
+    void dec_strong_ref(const void* src) noexcept {
+        if (this->m_strong.dec() == 0) {
+            this->destroy_resource();
+            notify_expired();
+            this->dec_weak_ref(src);
+        }
+    }
+
+private:
+    impl::spinlock m_lock;
+    listener_type* m_listeners = nullptr;
+    listener_type* m_notifying = nullptr; // the listener whose callback is running
+    std::thread::id m_notifying_thread;
+
+    void notify_expired() noexcept;
+
+    friend listener_type;
+};
+
+// An intrusive listener for the expiry of an object
+// While listening, it holds a weak ref to the control block
+// The callback is called once, with no locks held, and may unlisten or destroy the listener.
+// Unlistening (or destroying the listener) from another thread while the object expires is safe:
+// it waits for the callback of the listener to finish, if it's running. Thus it must not be done
+// while holding a lock which the callback takes.
+template <typename CB>
+class basic_expiry_listener {
+public:
+    using callback = void (*)(basic_expiry_listener& self) noexcept;
+
+    explicit basic_expiry_listener(callback cb) noexcept : m_callback(cb) {}
+    ~basic_expiry_listener() {
+        unlisten();
+    }
+
+    basic_expiry_listener(const basic_expiry_listener&) = delete;
+    basic_expiry_listener& operator=(const basic_expiry_listener&) = delete;
+
+    // listen for the expiry of the object of a shared or weak pointer (stops listening for a previous one)
+    // returns false if the pointer is null or expired
+    template <typename Ptr>
+    bool listen(const Ptr& ptr) noexcept {
+        unlisten();
+        auto cb = const_cast<CB*>(ptr.t_owner());
+        if (!cb) return false;
+        impl::spinlock::lock_guard _l(cb->m_lock);
+        if (cb->strong_ref_count() == 0) return false;
+        cb->inc_weak_ref(this);
+        m_cb = cb;
+        m_prev = nullptr;
+        m_next = cb->m_listeners;
+        if (m_next) m_next->m_prev = this;
+        cb->m_listeners = this;
+        m_linked = true;
+        return true;
+    }
+
+    void unlisten() noexcept {
+        if (!m_cb) return;
+        m_cb->m_lock.lock();
+        if (m_linked) {
+            unlink();
+        }
+        else if (m_cb->m_notifying == this && m_cb->m_notifying_thread != std::this_thread::get_id()) {
+            // the callback is running on another thread
+            while (m_cb->m_notifying == this) {
+                m_cb->m_lock.unlock();
+                std::this_thread::yield();
+                m_cb->m_lock.lock();
+            }
+        }
+        m_cb->m_lock.unlock();
+        auto cb = m_cb;
+        m_cb = nullptr;
+        cb->dec_weak_ref(this);
+    }
+
+    // whether it listens to an object which hasn't expired yet
+    [[nodiscard]] bool listening() const noexcept {
+        if (!m_cb) return false;
+        impl::spinlock::lock_guard _l(m_cb->m_lock);
+        return m_linked;
+    }
+
+private:
+    // with the lock of the control block
+    void unlink() noexcept {
+        if (m_prev) m_prev->m_next = m_next;
+        else m_cb->m_listeners = m_next;
+        if (m_next) m_next->m_prev = m_prev;
+        m_linked = false;
+    }
+
+    callback m_callback;
+    CB* m_cb = nullptr;
+    basic_expiry_listener* m_prev = nullptr;
+    basic_expiry_listener* m_next = nullptr;
+    bool m_linked = false; // guarded by the lock of the control block
+
+    friend CB;
+};
+
+// listeners are unlinked one by one, so the ones which haven't been notified yet can still unlisten
+// and the one being notified is not touched after its callback returns (it may be destroyed)
+template <typename RC>
+void basic_expiry_control_block<RC>::notify_expired() noexcept {
+    auto thread = std::this_thread::get_id();
+    m_lock.lock();
+    while (auto l = m_listeners) {
+        l->unlink();
+        m_notifying = l;
+        m_notifying_thread = thread;
+        m_lock.unlock();
+        l->m_callback(*l);
+        m_lock.lock();
+        m_notifying = nullptr;
+    }
+    m_lock.unlock();
+}
+
+using expiry_control_block_factory = control_block_factory<basic_expiry_control_block<atomic_ref_count>>;
+
+template <typename T>
+using expiry_shared_ptr = basic_shared_ptr<expiry_control_block_factory, T>;
+
+template <typename T>
+using expiry_weak_ptr = basic_weak_ptr<expiry_control_block_factory, T>;
+
+using expiry_listener = basic_expiry_listener<expiry_control_block_factory::cb_type>;
+
+template <typename T, typename... Args>
+[[nodiscard]] expiry_shared_ptr<T> make_expiry_shared(Args&&... args) {
+    return expiry_shared_ptr<T>(expiry_control_block_factory::make_resource_cb<T>(allocator<char>{}, std::forward<Args>(args)...));
+}
+
+using local_expiry_control_block_factory = control_block_factory<basic_expiry_control_block<local_ref_count>>;
+
+template <typename T>
+using local_expiry_shared_ptr = basic_shared_ptr<local_expiry_control_block_factory, T>;
+
+template <typename T>
+using local_expiry_weak_ptr = basic_weak_ptr<local_expiry_control_block_factory, T>;
+
+using local_expiry_listener = basic_expiry_listener<local_expiry_control_block_factory::cb_type>;
+
+template <typename T, typename... Args>
+[[nodiscard]] local_expiry_shared_ptr<T> make_local_expiry_shared(Args&&... args) {
+    return local_expiry_shared_ptr<T>(local_expiry_control_block_factory::make_resource_cb<T>(allocator<char>{}, std::forward<Args>(args)...));
+}
+
+}
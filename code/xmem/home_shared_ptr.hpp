@@ -0,0 +1,142 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "common_control_block.hpp"
+#include "atomic_ref_count.hpp"
+#include "bits/intrusive_mpsc_stack.hpp"
+
+#include <thread>
+#include <cassert>
+
+namespace xmem {
+
+class home_mailbox;
+class home_control_block;
+
+// Schedules home_mailbox::drain on the home thread of a mailbox (say by posting a task to its event loop)
+// schedule_drain is called from the releasing thread when a mailbox gets its first pending object
+// after a drain, so there is a single call per batch
+class home_executor {
+public:
+    virtual void schedule_drain(home_mailbox& mailbox) noexcept = 0;
+protected:
+    ~home_executor() = default;
+};
+
+// A queue of objects which must be destroyed on the thread which created the mailbox
+// While it exists, it is the mailbox of the objects created on its thread by the home factory
+// (only one mailbox per thread can exist at a time)
+// It must outlive the pointers to these objects
+class home_mailbox {
+public:
+    explicit home_mailbox(home_executor* executor = nullptr) noexcept
+        : m_executor(executor)
+        , m_home(std::this_thread::get_id())
+    {
+        assert(!current() && "a thread can only have one home mailbox");
+        current() = this;
+    }
+    ~home_mailbox() {
+        drain();
+        current() = nullptr;
+    }
+
+    home_mailbox(const home_mailbox&) = delete;
+    home_mailbox& operator=(const home_mailbox&) = delete;
+
+    [[nodiscard]] bool is_home() const noexcept { return std::this_thread::get_id() == m_home; }
+
+    // destroy the objects released from other threads
+    // must be called on the home thread
+    // returns the number of destroyed objects
+    size_t drain() noexcept;
+
+    // the mailbox of the calling thread or null
+    [[nodiscard]] static home_mailbox*& current() noexcept {
+        thread_local home_mailbox* the_mailbox = nullptr;
+        return the_mailbox;
+    }
+
+private:
+    friend class home_control_block;
+
+    void post(home_control_block* cb) noexcept {
+        if (m_stack.push(cb) && m_executor) {
+            m_executor->schedule_drain(*this);
+        }
+    }
+
+    impl::intrusive_mpsc_stack<home_control_block> m_stack;
+    home_executor* m_executor;
+    std::thread::id m_home;
+};
+
+// A control block which records the mailbox of the thread which creates it
+// The final strong release from another thread posts the block to the mailbox instead of destroying
+// the object, and the home thread destroys it when it drains its mailbox. The control block is the
+// message, so there is no allocation per release.
+// If the creating thread has no mailbox, the object is destroyed by whichever thread releases it.
+class home_control_block : public control_block_base<atomic_ref_count> {
+public:
+    home_control_block() noexcept : m_mailbox(home_mailbox::current()) {}
+
+    void dec_strong_ref(const void*) noexcept {
+        if (m_strong.dec() == 0) {
+            if (!m_mailbox || m_mailbox->is_home()) {
+                release();
+            }
+            else {
+                m_mailbox->post(this);
+            }
+        }
+    }
+
+    [[nodiscard]] home_mailbox* mailbox() const noexcept { return m_mailbox; }
+
+private:
+    home_mailbox* m_mailbox;
+    home_control_block* next = nullptr;
+
+    void release() noexcept {
+        destroy_resource();
+        dec_weak_ref(this);
+    }
+
+    friend class impl::intrusive_mpsc_stack<home_control_block>;
+    friend class home_mailbox;
+};
+
+inline size_t home_mailbox::drain() noexcept {
+    assert(is_home());
+    size_t ret = 0;
+    auto cb = m_stack.take_all();
+    while (cb) {
+        auto next = cb->next;
+        cb->release();
+        cb = next;
+        ++ret;
+    }
+    return ret;
+}
+
+using home_control_block_factory = control_block_factory<home_control_block>;
+
+template <typename T>
+using home_shared_ptr = basic_shared_ptr<home_control_block_factory, T>;
+
+template <typename T>
+using home_weak_ptr = basic_weak_ptr<home_control_block_factory, T>;
+
+using enable_home_shared_from = basic_enable_shared_from<home_control_block_factory>;
+
+template <typename T>
+using enable_home_shared_from_this = basic_enable_shared_from_this<home_control_block_factory, T>;
+
+// the object will be destroyed on the calling thread (if it has a home_mailbox)
+template <typename T, typename... Args>
+[[nodiscard]] home_shared_ptr<T> make_home_shared(Args&&... args) {
+    return home_shared_ptr<T>(home_control_block_factory::make_resource_cb<T>(allocator<char>{}, std::forward<Args>(args)...));
+}
+
+}
@@ -0,0 +1,105 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "pool_allocator.hpp"
+#include "bits/spinlock.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+
+#if defined(__linux__)
+#   include <sys/mman.h>
+#endif
+
+namespace xmem {
+
+struct huge_page_stats {
+    size_t regions; // number of 2 MiB regions
+    size_t hugetlb_regions; // of them, ones backed by explicit (MAP_HUGETLB) huge pages
+};
+
+namespace impl {
+
+// Memory in 2 MiB regions, aligned to 2 MiB
+// On Linux it tries explicit huge pages (MAP_HUGETLB) and falls back to transparent huge pages
+// (MADV_HUGEPAGE). Elsewhere the regions are only aligned.
+// Regions are never unmapped
+class huge_page_chunk_source {
+public:
+    static inline constexpr size_t region_size = 2 * 1024 * 1024;
+
+    static void* allocate_chunk(size_t size) {
+        auto& s = state();
+        spinlock::lock_guard _l(s.lock);
+        if (size_t(s.end - s.top) < size) {
+            s.top = static_cast<char*>(map_region());
+            s.end = s.top + region_size;
+        }
+        auto ret = s.top;
+        s.top += size;
+        return ret;
+    }
+
+    static huge_page_stats stats() noexcept {
+        auto& s = state();
+        return {s.regions.load(std::memory_order_relaxed), s.hugetlb_regions.load(std::memory_order_relaxed)};
+    }
+
+private:
+    struct state_t {
+        spinlock lock;
+        char* top = nullptr;
+        char* end = nullptr;
+        std::atomic_size_t regions = {};
+        std::atomic_size_t hugetlb_regions = {};
+    };
+    static state_t& state() noexcept {
+        static state_t s;
+        return s;
+    }
+
+    static void* map_region() {
+        auto& s = state();
+        s.regions.fetch_add(1, std::memory_order_relaxed);
+#if defined(__linux__)
+#   if defined(MAP_HUGETLB)
+        auto p = mmap(nullptr, region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            s.hugetlb_regions.fetch_add(1, std::memory_order_relaxed);
+            return p;
+        }
+#   endif
+        // map twice the size and trim to get an aligned region
+        auto raw = mmap(nullptr, 2 * region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED) throw std::bad_alloc();
+        auto begin = reinterpret_cast<uintptr_t>(raw);
+        auto aligned = (begin + region_size - 1) & ~uintptr_t(region_size - 1);
+        if (aligned != begin) munmap(raw, aligned - begin);
+        auto tail = aligned + region_size;
+        auto raw_end = begin + 2 * region_size;
+        if (tail != raw_end) munmap(reinterpret_cast<void*>(tail), raw_end - tail);
+        auto ret = reinterpret_cast<void*>(aligned);
+#   if defined(MADV_HUGEPAGE)
+        madvise(ret, region_size, MADV_HUGEPAGE);
+#   endif
+        return ret;
+#else
+        return ::operator new(region_size, std::align_val_t{region_size});
+#endif
+    }
+};
+
+}
+
+// A pool allocator (see pool_allocator.hpp) whose pools are in huge pages
+// Large populations of small objects in huge pages have far fewer TLB misses when pointer chasing
+template <typename T>
+using huge_page_allocator = basic_pool_allocator<T, impl::huge_page_chunk_source>;
+
+[[nodiscard]] inline huge_page_stats get_huge_page_stats() noexcept {
+    return impl::huge_page_chunk_source::stats();
+}
+
+}
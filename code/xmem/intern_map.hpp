@@ -0,0 +1,131 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "expiry_listener.hpp"
+#include "bits/shard_index.hpp"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace xmem {
+
+// A concurrent map which deduplicates values (hash-consing)
+// It holds weak refs to the values, so they live while someone uses them. The entry of a value
+// is an expiry listener and removes itself from the map when the value is destroyed (no sweeps).
+// The values should be immutable, since they are shared by everyone who asks for the same key.
+// The map is split into shards with a mutex each.
+// Values may outlive the map, but it must not be destroyed while its values are being released
+// on other threads.
+template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class intern_map {
+public:
+    using value_ptr = expiry_shared_ptr<V>;
+
+    explicit intern_map(unsigned num_shards = 16) {
+        m_shard_bits = impl::shard_bits(num_shards);
+        m_shards.reset(new shard[size_t(1) << m_shard_bits]);
+    }
+
+    intern_map(const intern_map&) = delete;
+    intern_map& operator=(const intern_map&) = delete;
+
+    // return the value for key or make one with factory() (which returns a value_ptr)
+    // the factory is called without locks, so it can intern other values
+    // (when threads race to create the same value, all but one created values are discarded)
+    // if the factory returns null, nothing is added
+    template <typename Factory>
+    value_ptr get_or_create(const K& key, Factory&& factory) {
+        auto& s = shard_for(key);
+        {
+            std::lock_guard<std::mutex> _l(s.mutex);
+            auto f = s.map.find(key);
+            if (f != s.map.end()) {
+                if (auto ret = f->second->value.lock()) return ret;
+            }
+        }
+
+        value_ptr value = factory();
+        if (!value) return value;
+        auto e = std::make_unique<entry>(s);
+        e->value = value;
+        e->listen(value); // can't fail while we hold value
+
+        std::lock_guard<std::mutex> _l(s.mutex);
+        auto [it, inserted] = s.map.try_emplace(key);
+        if (!inserted) {
+            if (auto existing = it->second->value.lock()) {
+                e.reset(); // unlisten before our value is released
+                return existing;
+            }
+            // the value of the old entry has expired, but its callback hasn't removed it yet
+            // it will delete itself instead
+            it->second->orphaned = true;
+            it->second.release();
+        }
+        e->key = &it->first;
+        it->second = std::move(e);
+        return value;
+    }
+
+    // return the value for key or null
+    [[nodiscard]] value_ptr find(const K& key) const {
+        auto& s = shard_for(key);
+        std::lock_guard<std::mutex> _l(s.mutex);
+        auto f = s.map.find(key);
+        if (f == s.map.end()) return {};
+        return f->second->value.lock();
+    }
+
+    // the number of entries (including expired ones which are about to be removed)
+    [[nodiscard]] size_t size() const {
+        size_t ret = 0;
+        for (size_t i = 0; i < num_shards(); ++i) {
+            std::lock_guard<std::mutex> _l(m_shards[i].mutex);
+            ret += m_shards[i].map.size();
+        }
+        return ret;
+    }
+
+    [[nodiscard]] size_t num_shards() const noexcept { return size_t(1) << m_shard_bits; }
+
+private:
+    struct shard;
+
+    struct entry : public expiry_listener {
+        explicit entry(shard& s) noexcept : expiry_listener(on_expire), owner(s) {}
+
+        shard& owner;
+        const K* key = nullptr; // the key of the map node which holds this
+        bool orphaned = false; // replaced in the map, guarded by the shard mutex
+        expiry_weak_ptr<V> value;
+
+        static void on_expire(expiry_listener& self) noexcept {
+            auto& e = static_cast<entry&>(self);
+            std::unique_lock<std::mutex> l(e.owner.mutex);
+            if (e.orphaned) {
+                l.unlock();
+                delete &e;
+            }
+            else {
+                e.owner.map.erase(*e.key); // destroys e
+            }
+        }
+    };
+
+    struct alignas(impl::cache_line_size) shard {
+        mutable std::mutex mutex;
+        std::unordered_map<K, std::unique_ptr<entry>, Hash, KeyEqual> map;
+    };
+
+    shard& shard_for(const K& key) const noexcept {
+        return m_shards[impl::shard_index(Hash{}(key), m_shard_bits)];
+    }
+
+    unsigned m_shard_bits;
+    std::unique_ptr<shard[]> m_shards;
+};
+
+}
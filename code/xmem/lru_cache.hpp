@@ -0,0 +1,288 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "shared_ptr.hpp"
+#include "bits/spinlock.hpp"
+#include "bits/shard_index.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace xmem {
+
+// A concurrent cache of shared pointers bounded by the total cost of its values
+// (the number of entries when all costs are 1, or the bytes if the costs are sizes)
+// * It's split into shards with a mutex each, and the capacity is split among them (the shards
+//   differ by at most 1). Small caches get fewer shards than requested, so that each shard has
+//   a capacity of at least min_shard_capacity. A value is only cached if its cost fits in the
+//   capacity of a shard, so caches of few large values should use few shards.
+// * Recency is approximated with CLOCK: a hit marks the entry, and the eviction hand clears the
+//   mark and gives the entry a second chance.
+// * Pinned entries (values which are also held outside of the cache, as seen by use_count) get
+//   a second chance too, since evicting them frees nothing. After two rounds of the hand over the
+//   shard the entry under it is evicted regardless.
+// * Evicted entries keep a weak ref. While their values are alive, get returns them and readmits
+//   them to the cache. Entries whose values have died are swept out, amortized over the evictions.
+// Values which are evicted or replaced are released after the shard mutex is unlocked.
+template <typename CBF, typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+class basic_lru_cache {
+public:
+    using value_ptr = basic_shared_ptr<CBF, V>;
+    using weak_value_ptr = basic_weak_ptr<CBF, V>;
+
+    static inline constexpr size_t min_shard_capacity = 16;
+
+    explicit basic_lru_cache(size_t capacity, unsigned num_shards = 16)
+        : m_shard_bits(shard_bits_for(capacity, num_shards))
+        , m_shards(new shard[size_t(1) << m_shard_bits])
+        , m_capacity(capacity)
+    {
+        auto n = this->num_shards();
+        for (size_t i = 0; i < n; ++i) {
+            m_shards[i].capacity = capacity / n + (i < capacity % n);
+        }
+    }
+
+    basic_lru_cache(const basic_lru_cache&) = delete;
+    basic_lru_cache& operator=(const basic_lru_cache&) = delete;
+
+    // add or replace the value for key (null values are not added)
+    // returns false if the value is not in the cache (say, if its cost is larger than the capacity of a shard)
+    // in this case it's still reachable through get while it's alive
+    bool insert(const K& key, value_ptr value, size_t cost = 1) {
+        if (!value) return false;
+        auto& s = shard_for(key);
+        std::vector<value_ptr> released;
+        std::lock_guard<std::mutex> _l(s.mutex);
+        s.reserve_ring_slot();
+        auto [it, inserted] = s.map.try_emplace(key);
+        auto& n = it->second;
+        // until it's admitted, the entry is an evicted one with a weak ref to the new value
+        // (so that if anything below throws, the shard is left consistent)
+        if (inserted) {
+            ++s.num_evicted;
+        }
+        else if (n.value) {
+            released.push_back(std::move(n.value));
+            s.remove_from_ring(n);
+            ++s.num_evicted;
+        }
+        n.weak = value;
+        n.cost = cost;
+        if (cost > s.capacity) {
+            s.maybe_sweep();
+            return false;
+        }
+        s.make_room(cost, released);
+        s.admit(*it, std::move(value), !inserted);
+        return true;
+    }
+
+    // return the value for key or null
+    // evicted values which are still alive are readmitted
+    [[nodiscard]] value_ptr get(const K& key) {
+        auto& s = shard_for(key);
+        std::vector<value_ptr> released;
+        std::lock_guard<std::mutex> _l(s.mutex);
+        auto f = s.map.find(key);
+        if (f == s.map.end()) return {};
+        auto& n = f->second;
+        if (n.value) {
+            n.referenced = true;
+            return n.value;
+        }
+        auto ret = n.weak.lock();
+        if (!ret) {
+            --s.num_evicted;
+            s.map.erase(f);
+            return ret;
+        }
+        if (n.cost > s.capacity) return ret;
+        s.reserve_ring_slot();
+        s.make_room(n.cost, released);
+        s.admit(*f, ret, true);
+        return ret;
+    }
+
+    // returns whether the key was in the cache (including evicted entries)
+    bool erase(const K& key) {
+        auto& s = shard_for(key);
+        value_ptr released;
+        std::lock_guard<std::mutex> _l(s.mutex);
+        auto f = s.map.find(key);
+        if (f == s.map.end()) return false;
+        auto& n = f->second;
+        if (n.value) {
+            released = std::move(n.value);
+            s.remove_from_ring(n);
+        }
+        else {
+            --s.num_evicted;
+        }
+        s.map.erase(f);
+        return true;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < num_shards(); ++i) {
+            auto& s = m_shards[i];
+            map_type released;
+            std::lock_guard<std::mutex> _l(s.mutex);
+            released.swap(s.map);
+            s.ring.clear();
+            s.hand = 0;
+            s.cost = 0;
+            s.num_evicted = 0;
+        }
+    }
+
+    // the number of values in the cache (not including evicted ones)
+    [[nodiscard]] size_t size() const {
+        size_t ret = 0;
+        for (size_t i = 0; i < num_shards(); ++i) {
+            std::lock_guard<std::mutex> _l(m_shards[i].mutex);
+            ret += m_shards[i].ring.size();
+        }
+        return ret;
+    }
+
+    // the total cost of the values in the cache
+    [[nodiscard]] size_t cost() const {
+        size_t ret = 0;
+        for (size_t i = 0; i < num_shards(); ++i) {
+            std::lock_guard<std::mutex> _l(m_shards[i].mutex);
+            ret += m_shards[i].cost;
+        }
+        return ret;
+    }
+
+    [[nodiscard]] size_t capacity() const noexcept { return m_capacity; }
+    [[nodiscard]] size_t num_shards() const noexcept { return size_t(1) << m_shard_bits; }
+
+private:
+    struct node {
+        value_ptr value; // null if evicted
+        weak_value_ptr weak;
+        size_t cost = 0;
+        size_t ring_index = 0;
+        bool referenced = false;
+    };
+
+    using map_type = std::unordered_map<K, node, Hash, KeyEqual>;
+    using entry = typename map_type::value_type;
+
+    static inline constexpr size_t min_sweep_threshold = 64;
+
+    struct alignas(impl::cache_line_size) shard {
+        mutable std::mutex mutex;
+        map_type map;
+        std::vector<entry*> ring; // the entries in the cache in CLOCK order
+        size_t hand = 0;
+        size_t cost = 0;
+        size_t capacity = 0;
+        size_t num_evicted = 0; // entries which only have a weak ref
+        size_t sweep_threshold = min_sweep_threshold;
+
+        // admitting is done in steps which can throw (but leave the shard consistent), followed
+        // by admit, which doesn't throw:
+        // reserve_ring_slot (before any change), make_room, admit
+
+        void reserve_ring_slot() {
+            if (ring.size() == ring.capacity()) ring.reserve(std::max(ring.size() * 2, size_t(16)));
+        }
+
+        // evict entries until there's room for new_cost (which must fit in the capacity)
+        // each eviction is complete before the next one, so if released can't grow, the shard is consistent
+        void make_room(size_t new_cost, std::vector<value_ptr>& released) {
+            while (cost + new_cost > capacity) {
+                evict_one(released);
+            }
+        }
+
+        // e is an evicted entry (with a weak ref to value) for which there's room
+        void admit(entry& e, value_ptr value, bool referenced) noexcept {
+            auto& n = e.second;
+            assert(ring.size() < ring.capacity());
+            assert(cost + n.cost <= capacity);
+            --num_evicted;
+            n.value = std::move(value);
+            n.referenced = referenced;
+            n.ring_index = ring.size();
+            ring.push_back(&e); // doesn't allocate
+            cost += n.cost;
+        }
+
+        void evict_one(std::vector<value_ptr>& released) {
+            for (size_t scanned = 0; ; ++scanned, ++hand) {
+                if (hand >= ring.size()) hand = 0;
+                auto& n = ring[hand]->second;
+                if (scanned < 2 * ring.size()) {
+                    if (n.referenced) {
+                        n.referenced = false;
+                        continue;
+                    }
+                    if (n.value.use_count() > 1) continue; // pinned
+                }
+                released.push_back(std::move(n.value));
+                remove_from_ring(n); // moves the last entry under the hand
+                on_evicted();
+                return;
+            }
+        }
+
+        void remove_from_ring(node& n) noexcept {
+            auto last = ring.back();
+            ring[n.ring_index] = last;
+            last->second.ring_index = n.ring_index;
+            ring.pop_back();
+            cost -= n.cost;
+        }
+
+        void on_evicted() {
+            ++num_evicted;
+            maybe_sweep();
+        }
+
+        void maybe_sweep() {
+            if (num_evicted < sweep_threshold) return;
+            // remove the evicted entries whose values have died
+            for (auto i = map.begin(); i != map.end(); ) {
+                if (!i->second.value && i->second.weak.expired()) {
+                    i = map.erase(i);
+                    --num_evicted;
+                }
+                else {
+                    ++i;
+                }
+            }
+            // there are at least as many evictions as the entries of the map until the next sweep
+            sweep_threshold = std::max(min_sweep_threshold, 2 * std::max(num_evicted, ring.size()));
+        }
+    };
+
+    static unsigned shard_bits_for(size_t capacity, unsigned num_shards) noexcept {
+        auto bits = impl::shard_bits(num_shards);
+        while (bits && (capacity >> bits) < min_shard_capacity) --bits;
+        return bits;
+    }
+
+    shard& shard_for(const K& key) const noexcept {
+        return m_shards[impl::shard_index(Hash{}(key), m_shard_bits)];
+    }
+
+    unsigned m_shard_bits;
+    std::unique_ptr<shard[]> m_shards;
+    size_t m_capacity;
+};
+
+template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K>>
+using lru_cache = basic_lru_cache<atomic_control_block_factory, K, V, Hash, KeyEqual>;
+
+}
@@ -0,0 +1,40 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "shared_ptr.hpp"
+#include "local_shared_ptr.hpp"
+
+#include <vector>
+
+namespace xmem {
+
+// n objects constructed with the same args in a single allocation, sharing a single control block
+// the returned pointers are aliases of the same owner, and the objects are destroyed with the last of them
+template <typename T, typename... Args>
+[[nodiscard]] std::vector<shared_ptr<T>> make_shared_batch(size_t n, const Args&... args) {
+    std::vector<shared_ptr<T>> ret;
+    if (n == 0) return ret;
+    ret.reserve(n);
+    ret.emplace_back(atomic_control_block_factory::make_array_resource_cb<T>(allocator<char>{}, n, args...));
+    auto& first = ret.front();
+    for (size_t i = 1; i < n; ++i) {
+        ret.emplace_back(first, first.get() + i);
+    }
+    return ret;
+}
+
+template <typename T, typename... Args>
+[[nodiscard]] std::vector<local_shared_ptr<T>> make_local_shared_batch(size_t n, const Args&... args) {
+    std::vector<local_shared_ptr<T>> ret;
+    if (n == 0) return ret;
+    ret.reserve(n);
+    ret.emplace_back(local_control_block_factory::make_array_resource_cb<T>(allocator<char>{}, n, args...));
+    auto& first = ret.front();
+    for (size_t i = 1; i < n; ++i) {
+        ret.emplace_back(first, first.get() + i);
+    }
+    return ret;
+}
+
+}
@@ -0,0 +1,36 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "shared_ptr.hpp"
+#include "local_shared_ptr.hpp"
+
+#include <vector>
+
+namespace xmem {
+
+// n objects constructed with the same args in a single allocation, each with its own control block
+// the objects are destroyed independently, and the memory is freed when the last one is destroyed
+template <typename T, typename... Args>
+[[nodiscard]] std::vector<shared_ptr<T>> make_shared_slab(size_t n, const Args&... args) {
+    std::vector<shared_ptr<T>> ret;
+    if (n == 0) return ret;
+    ret.reserve(n);
+    atomic_control_block_factory::make_slab_resource_cbs<T>(allocator<char>{}, n, [&](auto&& pair) {
+        ret.emplace_back(std::move(pair));
+    }, args...);
+    return ret;
+}
+
+template <typename T, typename... Args>
+[[nodiscard]] std::vector<local_shared_ptr<T>> make_local_shared_slab(size_t n, const Args&... args) {
+    std::vector<local_shared_ptr<T>> ret;
+    if (n == 0) return ret;
+    ret.reserve(n);
+    local_control_block_factory::make_slab_resource_cbs<T>(allocator<char>{}, n, [&](auto&& pair) {
+        ret.emplace_back(std::move(pair));
+    }, args...);
+    return ret;
+}
+
+}
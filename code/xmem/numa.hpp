@@ -0,0 +1,340 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "shared_ptr.hpp"
+#include "bits/spinlock.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <vector>
+#include <memory>
+
+#if defined(__linux__)
+#   include <unistd.h>
+#   include <sys/syscall.h>
+#endif
+
+namespace xmem {
+
+// The NUMA nodes of a machine and how to place memory on them
+class numa_topology {
+public:
+    virtual ~numa_topology() = default;
+
+    [[nodiscard]] virtual unsigned num_nodes() const noexcept = 0;
+
+    // node of the cpu the calling thread runs on
+    [[nodiscard]] virtual unsigned current_node() const noexcept = 0;
+
+    // prefer node for the pages of a page-aligned range
+    // node must be less than num_nodes()
+    // placement is a hint: failures are ignored
+    virtual void bind(void* ptr, size_t size, unsigned node) noexcept = 0;
+
+    // the topology of this machine
+    // on non-Linux systems (or if the information is unavailable) it has a single node
+    static numa_topology& system();
+};
+
+// A topology with a given number of nodes which only records bindings
+// The current node is set per thread, so NUMA placement can be tested on any machine
+class simulated_numa_topology final : public numa_topology {
+public:
+    explicit simulated_numa_topology(unsigned num_nodes) : m_num_nodes(num_nodes) {}
+
+    unsigned num_nodes() const noexcept override { return m_num_nodes; }
+
+    unsigned current_node() const noexcept override { return thread_node(); }
+    static void set_current_node(unsigned node) noexcept { thread_node() = node; }
+
+    void bind(void* ptr, size_t size, unsigned node) noexcept override {
+        assert(node < m_num_nodes);
+        impl::spinlock::lock_guard _l(m_lock);
+        m_bindings.push_back({reinterpret_cast<uintptr_t>(ptr), size, node});
+    }
+
+    // the node a pointer was bound to or -1 if it wasn't
+    [[nodiscard]] int node_of(const void* ptr) const noexcept {
+        auto p = reinterpret_cast<uintptr_t>(ptr);
+        impl::spinlock::lock_guard _l(m_lock);
+        for (auto& b : m_bindings) {
+            if (p >= b.begin && p < b.begin + b.size) return int(b.node);
+        }
+        return -1;
+    }
+
+private:
+    static unsigned& thread_node() noexcept {
+        thread_local unsigned node = 0;
+        return node;
+    }
+
+    struct binding {
+        uintptr_t begin;
+        size_t size;
+        unsigned node;
+    };
+
+    unsigned m_num_nodes;
+    mutable impl::spinlock m_lock;
+    std::vector<binding> m_bindings;
+};
+
+namespace impl {
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+class linux_numa_topology final : public numa_topology {
+public:
+    linux_numa_topology() noexcept {
+        // the format is a list of ranges such as "0-1" or "0,2-3"
+        // we only need the highest node
+        if (auto f = fopen("/sys/devices/system/node/online", "r")) {
+            unsigned a, b;
+            char sep;
+            while (fscanf(f, "%u", &a) == 1) {
+                b = a;
+                if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+                    if (fscanf(f, "%u", &b) != 1) break;
+                    if (fscanf(f, "%c", &sep) != 1) sep = 0;
+                }
+                if (b + 1 > m_num_nodes) m_num_nodes = b + 1;
+                if (sep != ',') break;
+            }
+            fclose(f);
+        }
+        // nodes above the mask we pass to mbind are ignored
+        if (m_num_nodes > max_nodes) m_num_nodes = max_nodes;
+    }
+
+    unsigned num_nodes() const noexcept override { return m_num_nodes; }
+
+    unsigned current_node() const noexcept override {
+        if (m_num_nodes == 1) return 0;
+        unsigned cpu = 0, node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return 0;
+        return node < m_num_nodes ? node : 0;
+    }
+
+    void bind(void* ptr, size_t size, unsigned node) noexcept override {
+        assert(node < m_num_nodes);
+        if (m_num_nodes == 1 || node >= m_num_nodes) return;
+        constexpr int mpol_preferred = 1;
+        constexpr unsigned mpol_mf_move = 1 << 1;
+        constexpr unsigned word_bits = sizeof(unsigned long) * 8;
+        unsigned long mask[max_nodes / word_bits] = {};
+        mask[node / word_bits] = 1ul << (node % word_bits);
+        // the kernel reads one bit less than maxnode
+        syscall(SYS_mbind, ptr, size, mpol_preferred, mask, (unsigned long)max_nodes + 1, mpol_mf_move);
+    }
+
+private:
+    // the largest node count the kernel supports (CONFIG_NODES_SHIFT=10)
+    static inline constexpr unsigned max_nodes = 1024;
+
+    unsigned m_num_nodes = 1;
+};
+using system_numa_topology = linux_numa_topology;
+#else
+class single_node_topology final : public numa_topology {
+public:
+    unsigned num_nodes() const noexcept override { return 1; }
+    unsigned current_node() const noexcept override { return 0; }
+    void bind(void*, size_t, unsigned) noexcept override {}
+};
+using system_numa_topology = single_node_topology;
+#endif
+}
+
+inline numa_topology& numa_topology::system() {
+    static impl::system_numa_topology the_topology;
+    return the_topology;
+}
+
+// A pool of blocks which are placed on a single node
+// Memory is carved from page-aligned chunks bound to the node. Freed blocks are kept in exact-size
+// free lists and are only returned to the system when the pool is destroyed.
+// Large blocks get their own pages.
+class numa_node_pool {
+public:
+    static inline constexpr size_t granularity = 16;
+    static inline constexpr size_t page_size = 4096;
+    static inline constexpr size_t chunk_size = 256 * 1024;
+    static inline constexpr size_t max_block_size = chunk_size / 4;
+
+    numa_node_pool(numa_topology& topology, unsigned node) noexcept
+        : m_topology(topology)
+        , m_node(node)
+    {}
+    ~numa_node_pool() {
+        for (auto c : m_chunks) {
+            ::operator delete(c, std::align_val_t{page_size});
+        }
+    }
+
+    numa_node_pool(const numa_node_pool&) = delete;
+    numa_node_pool& operator=(const numa_node_pool&) = delete;
+
+    [[nodiscard]] unsigned node() const noexcept { return m_node; }
+
+    [[nodiscard]] void* allocate(size_t size, size_t align) {
+        if (align > granularity) size += align + granularity;
+        auto n = granules_for(size);
+        void* ret;
+        if (n * granularity > max_block_size) {
+            ret = allocate_large(n * granularity);
+        }
+        else {
+            spinlock::lock_guard _l(m_lock);
+            if (m_free.size() <= n) m_free.resize(n + 1, nullptr);
+            auto& head = m_free[n];
+            if (head) {
+                ret = head;
+                head = *static_cast<void**>(head);
+            }
+            else {
+                if (size_t(m_end - m_top) < n * granularity) {
+                    m_top = static_cast<char*>(new_chunk());
+                    m_end = m_top + chunk_size;
+                }
+                ret = m_top;
+                m_top += n * granularity;
+            }
+        }
+        if (align > granularity) {
+            // store the offset before the aligned block
+            auto p = reinterpret_cast<uintptr_t>(ret);
+            auto aligned = (p + granularity + align - 1) & ~uintptr_t(align - 1);
+            reinterpret_cast<uintptr_t*>(aligned)[-1] = aligned - p;
+            return reinterpret_cast<void*>(aligned);
+        }
+        return ret;
+    }
+
+    void deallocate(void* ptr, size_t size, size_t align) noexcept {
+        if (align > granularity) {
+            size += align + granularity;
+            auto aligned = reinterpret_cast<uintptr_t>(ptr);
+            ptr = reinterpret_cast<void*>(aligned - reinterpret_cast<uintptr_t*>(aligned)[-1]);
+        }
+        auto n = granules_for(size);
+        if (n * granularity > max_block_size) {
+            ::operator delete(ptr, std::align_val_t{page_size});
+            return;
+        }
+        spinlock::lock_guard _l(m_lock);
+        auto& head = m_free[n];
+        *static_cast<void**>(ptr) = head;
+        head = ptr;
+    }
+
+private:
+    using spinlock = impl::spinlock;
+
+    static size_t granules_for(size_t size) noexcept {
+        return size ? (size + granularity - 1) / granularity : 1;
+    }
+
+    // locked
+    void* new_chunk() {
+        auto c = ::operator new(chunk_size, std::align_val_t{page_size});
+        m_chunks.push_back(c);
+        m_topology.bind(c, chunk_size, m_node);
+        return c;
+    }
+
+    // large blocks are allocated and freed individually
+    void* allocate_large(size_t size) {
+        auto ret = ::operator new(size, std::align_val_t{page_size});
+        m_topology.bind(ret, (size + page_size - 1) / page_size * page_size, m_node);
+        return ret;
+    }
+
+    numa_topology& m_topology;
+    unsigned m_node;
+    spinlock m_lock;
+    char* m_top = nullptr;
+    char* m_end = nullptr;
+    std::vector<void*> m_free; // index is size in granules
+    std::vector<void*> m_chunks;
+};
+
+// A pool per node of a topology
+class numa_pools {
+public:
+    explicit numa_pools(numa_topology& topology) : m_topology(topology) {
+        for (unsigned i = 0; i < topology.num_nodes(); ++i) {
+            m_pools.emplace_back(std::make_unique<numa_node_pool>(topology, i));
+        }
+    }
+
+    [[nodiscard]] numa_topology& topology() const noexcept { return m_topology; }
+    // n must be a node of the topology
+    [[nodiscard]] numa_node_pool& node(unsigned n) const noexcept {
+        assert(n < m_pools.size());
+        return *m_pools[n];
+    }
+    [[nodiscard]] numa_node_pool& current() const noexcept { return node(m_topology.current_node()); }
+
+    // pools for the system topology (leaked, so pointers can be destroyed during static destruction)
+    static numa_pools& system() {
+        static numa_pools* the_pools = new numa_pools(numa_topology::system());
+        return *the_pools;
+    }
+
+private:
+    numa_topology& m_topology;
+    std::vector<std::unique_ptr<numa_node_pool>> m_pools;
+};
+
+// An allocator which places memory on a NUMA node
+// Copies (and rebinds) allocate on the same node, so a control block is freed to the pool it came from
+template <typename T>
+class numa_allocator {
+public:
+    using value_type = T;
+
+    // on the node of the calling thread
+    // not noexcept, since the first use creates the pools of the system
+    numa_allocator() : numa_allocator(numa_pools::system()) {}
+    explicit numa_allocator(numa_pools& pools) noexcept : m_pool(&pools.current()) {}
+    numa_allocator(numa_pools& pools, unsigned node) noexcept : m_pool(&pools.node(node)) {}
+
+    numa_allocator(const numa_allocator&) noexcept = default;
+    template <typename U>
+    numa_allocator(const numa_allocator<U>& other) noexcept : m_pool(&other.pool()) {}
+
+    [[nodiscard]] T* allocate(size_t n) {
+        return static_cast<T*>(m_pool->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T* ptr, size_t n) noexcept {
+        m_pool->deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    [[nodiscard]] numa_node_pool& pool() const noexcept { return *m_pool; }
+    [[nodiscard]] unsigned node() const noexcept { return m_pool->node(); }
+
+    template <typename U>
+    bool operator==(const numa_allocator<U>& other) const noexcept { return m_pool == &other.pool(); }
+    template <typename U>
+    bool operator!=(const numa_allocator<U>& other) const noexcept { return m_pool != &other.pool(); }
+
+private:
+    numa_node_pool* m_pool;
+};
+
+// the control block and the object are placed on the node of the calling thread
+template <typename T, typename... Args>
+[[nodiscard]] shared_ptr<T> make_numa_shared(Args&&... args) {
+    return allocate_shared<T>(numa_allocator<char>{}, std::forward<Args>(args)...);
+}
+
+// the control block and the object are placed on a given node, which must be a node of the system
+template <typename T, typename... Args>
+[[nodiscard]] shared_ptr<T> make_numa_shared_on(unsigned node, Args&&... args) {
+    return allocate_shared<T>(numa_allocator<char>(numa_pools::system(), node), std::forward<Args>(args)...);
+}
+
+}
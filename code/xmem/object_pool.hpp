@@ -0,0 +1,199 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "shared_ptr.hpp"
+#include "local_shared_ptr.hpp"
+#include "allocator.hpp"
+#include "bits/spinlock.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+namespace xmem {
+
+// the default recycle hook of object pools: objects are returned as they are
+struct no_recycle_reset {
+    template <typename T>
+    void operator()(T&) const noexcept {}
+};
+
+// A pool of objects which are recycled instead of destroyed
+// When the last strong ref to an acquired object is released, the object is reset with the hook
+// (Reset::operator()(T&), which must not throw). When the last weak ref is released too, its control
+// block is pushed to a lock-free free list, and a following acquire() returns it without an allocation
+// or a constructor call.
+// The objects are destroyed when the pool is. The pool must outlive all pointers acquired from it.
+template <typename CBF, typename T, typename Reset = no_recycle_reset>
+class basic_object_pool : private /*EBO*/ Reset {
+public:
+    using factory = CBF;
+    using cb_type = typename CBF::cb_type;
+    using sptr = basic_shared_ptr<CBF, T>;
+
+    explicit basic_object_pool(Reset reset = {}) noexcept : Reset(std::move(reset)) {}
+
+    ~basic_object_pool() {
+        uint32_t recycled = 0;
+        while (auto n = pop(m_head)) {
+            n->obj.~T();
+            ++recycled;
+        }
+        (void)recycled;
+        assert(recycled == m_created.load(std::memory_order_relaxed) && "objects outlive the pool");
+        for (uint32_t k = 0; k < max_chunks; ++k) {
+            auto c = m_chunks[k].load(std::memory_order_relaxed);
+            if (!c) break;
+            allocator<node>().deallocate(c, chunk_capacity(k));
+        }
+    }
+
+    basic_object_pool(const basic_object_pool&) = delete;
+    basic_object_pool& operator=(const basic_object_pool&) = delete;
+
+    // a recycled object if there is one (args are ignored)
+    // otherwise a new object constructed with args
+    template <typename... Args>
+    [[nodiscard]] sptr acquire(Args&&... args) {
+        auto n = pop(m_head);
+        if (!n) {
+            n = pop(m_raw_head);
+            if (!n) n = new_node();
+            try {
+                new (&n->obj) T(std::forward<Args>(args)...);
+            }
+            catch (...) {
+                // keep the node for the next acquire
+                push(m_raw_head, n);
+                throw;
+            }
+            m_created.fetch_add(1, std::memory_order_relaxed);
+        }
+        auto cb = new (&n->cb) recycle_cb(this, n);
+        return sptr(CBF::prepare_pair(static_cast<cb_type*>(cb), &n->obj));
+    }
+
+    // number of objects constructed so far
+    [[nodiscard]] size_t created() const noexcept {
+        return m_created.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct node;
+
+    class recycle_cb final : public cb_type {
+        basic_object_pool* m_pool;
+        node* m_node;
+    public:
+        recycle_cb(basic_object_pool* pool, node* n) noexcept : m_pool(pool), m_node(n) {}
+
+        virtual void destroy_resource() noexcept override {
+            static_cast<Reset&>(*m_pool)(m_node->obj);
+        }
+        virtual void destroy_self() noexcept override {
+            auto pool = m_pool;
+            auto n = m_node;
+            this->~recycle_cb();
+            pool->push(pool->m_head, n);
+        }
+    };
+
+    struct node {
+        union {
+            recycle_cb cb; // constructed anew with every acquire
+        };
+        union {
+            T obj; // constructed once and kept while the node is in the free list
+        };
+        std::atomic_uint32_t next; // free list link: index + 1 or 0
+        uint32_t index;
+
+        explicit node(uint32_t i) noexcept : next(0), index(i) {}
+        ~node() {}
+    };
+
+    // nodes live in chunks which double in size and are never freed while the pool is alive,
+    // so a node can be found by index without a lock
+    static inline constexpr uint32_t first_chunk_capacity = 64;
+    static inline constexpr uint32_t max_chunks = 24;
+
+    static constexpr uint32_t chunk_capacity(uint32_t k) noexcept {
+        return first_chunk_capacity << k;
+    }
+    static constexpr uint32_t chunk_begin(uint32_t k) noexcept {
+        return first_chunk_capacity * ((1u << k) - 1);
+    }
+    static uint32_t chunk_of(uint32_t index) noexcept {
+        uint32_t k = 0;
+        for (auto c = index / first_chunk_capacity + 1; c > 1; c >>= 1) ++k;
+        return k;
+    }
+
+    node* node_at(uint32_t index) const noexcept {
+        auto k = chunk_of(index);
+        return m_chunks[k].load(std::memory_order_acquire) + (index - chunk_begin(k));
+    }
+
+    node* new_node() {
+        auto index = m_next_index.fetch_add(1, std::memory_order_relaxed);
+        auto k = chunk_of(index);
+        if (k >= max_chunks) throw std::bad_alloc();
+        auto c = m_chunks[k].load(std::memory_order_acquire);
+        if (!c) {
+            impl::spinlock::lock_guard _l(m_grow_lock);
+            c = m_chunks[k].load(std::memory_order_relaxed);
+            if (!c) {
+                c = allocator<node>().allocate(chunk_capacity(k));
+                m_chunks[k].store(c, std::memory_order_release);
+            }
+        }
+        return new (c + (index - chunk_begin(k))) node(index);
+    }
+
+    // Treiber stacks (of recycled objects and of nodes without objects)
+    // the head packs a tag (incremented on every push) with the index, so a pop can't be fooled by
+    // a node which was popped and pushed back in the meantime (ABA)
+    static uint64_t pack(uint32_t tag, uint32_t link) noexcept {
+        return (uint64_t(tag) << 32) | link;
+    }
+
+    void push(std::atomic_uint64_t& stack, node* n) noexcept {
+        auto head = stack.load(std::memory_order_relaxed);
+        uint64_t new_head;
+        do {
+            n->next.store(uint32_t(head), std::memory_order_relaxed);
+            new_head = pack(uint32_t(head >> 32) + 1, n->index + 1);
+        } while (!stack.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    node* pop(std::atomic_uint64_t& stack) noexcept {
+        auto head = stack.load(std::memory_order_acquire);
+        node* n;
+        do {
+            auto link = uint32_t(head);
+            if (!link) return nullptr;
+            n = node_at(link - 1);
+            // n may be concurrently popped, in which case next may be stale, but the tag will fail the exchange
+            auto next = n->next.load(std::memory_order_relaxed);
+            if (stack.compare_exchange_weak(head, pack(uint32_t(head >> 32), next), std::memory_order_acquire, std::memory_order_acquire)) {
+                return n;
+            }
+        } while (true);
+    }
+
+    alignas(impl::cache_line_size) std::atomic_uint64_t m_head = {0}; // recycled objects
+    std::atomic_uint64_t m_raw_head = {0}; // nodes whose object constructor threw (no object)
+    alignas(impl::cache_line_size) std::atomic_uint32_t m_next_index = {0};
+    std::atomic_uint32_t m_created = {0};
+    impl::spinlock m_grow_lock;
+    std::atomic<node*> m_chunks[max_chunks] = {};
+};
+
+template <typename T, typename Reset = no_recycle_reset>
+using object_pool = basic_object_pool<atomic_control_block_factory, T, Reset>;
+
+template <typename T, typename Reset = no_recycle_reset>
+using local_object_pool = basic_object_pool<local_control_block_factory, T, Reset>;
+
+}
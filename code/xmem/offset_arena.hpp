@@ -0,0 +1,162 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "bits/spinlock.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <map>
+
+namespace xmem {
+
+// A contiguous block of memory whose allocations can be addressed with 32-bit offsets
+// Offsets are in units of `granularity` bytes, so an arena can be up to 32 GiB
+// Offset 0 is reserved for null
+// Freed blocks are kept in exact-size free lists, which is a good fit for the few
+// distinct sizes of control blocks an arena typically serves
+class offset_arena {
+public:
+    using offset_type = uint32_t;
+    static inline constexpr size_t granularity = 8;
+    static inline constexpr size_t max_capacity = size_t(UINT32_MAX) * granularity;
+
+    explicit offset_arena(size_t capacity)
+        : m_capacity(granules_for(capacity > max_capacity ? max_capacity : capacity))
+        , m_top(1) // skip null
+    {
+        m_buf = static_cast<char*>(::operator new(size_t(m_capacity) * granularity, std::align_val_t{granularity}));
+    }
+    ~offset_arena() {
+        ::operator delete(m_buf, std::align_val_t{granularity});
+    }
+
+    offset_arena(const offset_arena&) = delete;
+    offset_arena& operator=(const offset_arena&) = delete;
+
+    [[nodiscard]] void* allocate(size_t size) {
+        // larger sizes don't fit in offset_type granules
+        if (size > max_capacity) throw std::bad_alloc();
+        auto n = granules_for(size);
+        impl::spinlock::lock_guard _l(m_spinlock);
+        offset_type off;
+        auto& head = free_head(n);
+        if (head) {
+            off = head;
+            head = next_free(off);
+        }
+        else {
+            if (m_capacity - m_top < n) throw std::bad_alloc();
+            off = m_top;
+            m_top += n;
+        }
+        return m_buf + size_t(off) * granularity;
+    }
+
+    void deallocate(void* ptr, size_t size) noexcept {
+        auto n = granules_for(size);
+        auto off = to_offset(ptr);
+        impl::spinlock::lock_guard _l(m_spinlock);
+        auto& head = allocated_free_head(n);
+        next_free(off) = head;
+        head = off;
+    }
+
+    [[nodiscard]] offset_type to_offset(const void* ptr) const noexcept {
+        if (!ptr) return 0;
+        return offset_type(size_t(static_cast<const char*>(ptr) - m_buf) / granularity);
+    }
+
+    [[nodiscard]] void* from_offset(offset_type off) const noexcept {
+        if (!off) return nullptr;
+        return m_buf + size_t(off) * granularity;
+    }
+
+    // whether a pointer can be represented as an offset in this arena
+    [[nodiscard]] bool addressable(const void* ptr) const noexcept {
+        auto p = static_cast<const char*>(ptr);
+        return !ptr || (p >= m_buf + granularity && p < m_buf + size_t(m_capacity) * granularity
+            && size_t(p - m_buf) % granularity == 0);
+    }
+
+    [[nodiscard]] size_t capacity() const noexcept { return size_t(m_capacity) * granularity; }
+
+    // bytes taken from the arena (including ones which are in the free lists)
+    [[nodiscard]] size_t used() const noexcept {
+        impl::spinlock::lock_guard _l(m_spinlock);
+        return size_t(m_top) * granularity;
+    }
+
+private:
+    static offset_type granules_for(size_t size) noexcept {
+        if (size == 0) size = 1;
+        return offset_type((size + granularity - 1) / granularity);
+    }
+
+    // small sizes have a directly indexed free list
+    static inline constexpr offset_type max_small_granules = 512;
+
+    // may allocate the free list for n
+    offset_type& free_head(offset_type n) {
+        if (n <= max_small_granules) {
+            if (m_small_free.size() <= n) m_small_free.resize(n + 1, 0);
+            return m_small_free[n];
+        }
+        return m_large_free[n];
+    }
+
+    // the free list for n was allocated by the allocate call of the block which is being freed
+    offset_type& allocated_free_head(offset_type n) noexcept {
+        if (n <= max_small_granules) {
+            assert(m_small_free.size() > n);
+            return m_small_free[n];
+        }
+        auto f = m_large_free.find(n);
+        assert(f != m_large_free.end());
+        return f->second;
+    }
+
+    offset_type& next_free(offset_type off) noexcept {
+        return *reinterpret_cast<offset_type*>(m_buf + size_t(off) * granularity);
+    }
+
+    char* m_buf;
+    offset_type m_capacity; // in granules
+    offset_type m_top; // in granules
+    std::vector<offset_type> m_small_free;
+    std::map<offset_type, offset_type> m_large_free;
+    mutable impl::spinlock m_spinlock;
+};
+
+// A stateless allocator which allocates from the arena of a domain
+// A domain is a type with a static function `offset_arena& arena()`
+// As the domain is a part of the type, no space is wasted for the allocator in control blocks
+template <typename T, typename Domain>
+class offset_allocator {
+public:
+    using value_type = T;
+    using domain_type = Domain;
+
+    offset_allocator() noexcept = default;
+    offset_allocator(const offset_allocator&) noexcept = default;
+    template <typename U>
+    offset_allocator(const offset_allocator<U, Domain>&) noexcept {}
+
+    [[nodiscard]] T* allocate(size_t n) {
+        static_assert(alignof(T) <= offset_arena::granularity, "type is overaligned for offset arenas");
+        return static_cast<T*>(Domain::arena().allocate(n * sizeof(T)));
+    }
+    void deallocate(T* ptr, size_t n) {
+        Domain::arena().deallocate(ptr, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const offset_allocator<U, Domain>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const offset_allocator<U, Domain>&) const noexcept { return false; }
+};
+
+}
@@ -0,0 +1,280 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "common_control_block.hpp"
+#include "atomic_ref_count.hpp"
+#include "bits/spinlock.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xmem {
+
+class teardown_control_block;
+class release_pool;
+
+namespace impl {
+// a work-stealing queue of control blocks whose objects are to be destroyed
+struct alignas(cache_line_size) teardown_worker {
+    spinlock lock;
+    teardown_control_block* head = nullptr;
+    size_t size = 0;
+
+    release_pool* pool = nullptr;
+
+    void push(teardown_control_block* cb) noexcept;
+    teardown_control_block* pop() noexcept;
+
+    // move half of the blocks of the victim to this
+    bool steal_from(teardown_worker& victim) noexcept;
+
+    // the worker of the calling thread while it takes part in a parallel release
+    static teardown_worker*& current() noexcept {
+        thread_local teardown_worker* the_worker = nullptr;
+        return the_worker;
+    }
+};
+}
+
+// A control block whose final release, when it happens in a parallel_release, doesn't destroy the
+// object inline, but queues it to the release pool, so that other threads can steal it
+// Outside of a parallel release it is a regular control block
+class teardown_control_block : public control_block_base<atomic_ref_count> {
+public:
+    void dec_strong_ref(const void*) noexcept {
+        if (m_strong.dec() == 0) {
+            if (auto w = impl::teardown_worker::current()) {
+                w->push(this);
+            }
+            else {
+                release();
+            }
+        }
+    }
+
+private:
+    teardown_control_block* next = nullptr;
+
+    void release() noexcept {
+        destroy_resource();
+        dec_weak_ref(this);
+    }
+
+    friend struct impl::teardown_worker;
+    friend class release_pool;
+};
+
+using teardown_control_block_factory = control_block_factory<teardown_control_block>;
+
+template <typename T>
+using teardown_shared_ptr = basic_shared_ptr<teardown_control_block_factory, T>;
+
+template <typename T>
+using teardown_weak_ptr = basic_weak_ptr<teardown_control_block_factory, T>;
+
+template <typename T, typename... Args>
+[[nodiscard]] teardown_shared_ptr<T> make_teardown_shared(Args&&... args) {
+    return teardown_shared_ptr<T>(teardown_control_block_factory::make_resource_cb<T>(allocator<char>{}, std::forward<Args>(args)...));
+}
+
+// A pool of threads which destroy object graphs in parallel
+// The thread which calls release takes part in it, so a pool of n threads has n-1 background threads
+// Final releases discovered while destroying objects go to the queue of the thread which discovered
+// them and idle threads steal from the others
+class release_pool {
+public:
+    explicit release_pool(unsigned num_threads = std::thread::hardware_concurrency()) {
+        if (num_threads == 0) num_threads = 1;
+        m_workers.reset(new impl::teardown_worker[num_threads]);
+        m_num_workers = num_threads;
+        for (unsigned i = 0; i < num_threads; ++i) {
+            m_workers[i].pool = this;
+        }
+        try {
+            for (unsigned i = 1; i < num_threads; ++i) {
+                m_threads.emplace_back([this, i]() { thread_run(m_workers[i]); });
+            }
+        }
+        catch (...) {
+            // the threads which did start must be joined before they're destroyed
+            stop();
+            throw;
+        }
+    }
+
+    ~release_pool() {
+        stop();
+    }
+
+    release_pool(const release_pool&) = delete;
+    release_pool& operator=(const release_pool&) = delete;
+
+    [[nodiscard]] unsigned num_threads() const noexcept { return m_num_workers; }
+
+    // release the pointers and wait for all objects which this destroys
+    // concurrent calls are serialized, but the destructors of the released objects must not call
+    // release (of any pool)
+    template <typename T>
+    void release(std::vector<teardown_shared_ptr<T>>&& ptrs) noexcept {
+        auto& cur = impl::teardown_worker::current();
+        assert(!cur && "release called from a parallel release");
+        std::lock_guard<std::mutex> _l(m_release_mutex);
+        // distribute the initial releases among the workers
+        for (size_t i = 0; i < ptrs.size(); ++i) {
+            cur = &m_workers[i % m_num_workers];
+            ptrs[i].reset();
+        }
+        cur = nullptr;
+        ptrs.clear();
+        run();
+    }
+
+private:
+    friend struct impl::teardown_worker;
+
+    void stop() noexcept {
+        {
+            std::lock_guard<std::mutex> _l(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto& t : m_threads) t.join();
+    }
+
+    void run() noexcept {
+        if (m_num_workers > 1) {
+            {
+                std::lock_guard<std::mutex> _l(m_mutex);
+                ++m_generation;
+                m_active = m_num_workers - 1;
+            }
+            m_cv.notify_all();
+        }
+        work(m_workers[0]);
+        if (m_num_workers > 1) {
+            std::unique_lock<std::mutex> l(m_mutex);
+            m_done_cv.wait(l, [this]() { return m_active == 0; });
+        }
+    }
+
+    void thread_run(impl::teardown_worker& w) {
+        uint64_t generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> l(m_mutex);
+                m_cv.wait(l, [&]() { return m_stop || m_generation != generation; });
+                if (m_stop) return;
+                generation = m_generation;
+            }
+            work(w);
+            {
+                std::lock_guard<std::mutex> _l(m_mutex);
+                --m_active;
+            }
+            m_done_cv.notify_one();
+        }
+    }
+
+    // until there are no pending blocks
+    void work(impl::teardown_worker& w) noexcept {
+        auto& cur = impl::teardown_worker::current();
+        cur = &w;
+        auto index = size_t(&w - m_workers.get());
+        while (m_pending.load(std::memory_order_acquire)) {
+            auto cb = w.pop();
+            if (!cb) {
+                for (size_t i = 1; i < m_num_workers; ++i) {
+                    if (w.steal_from(m_workers[(index + i) % m_num_workers])) break;
+                }
+                cb = w.pop();
+            }
+            if (!cb) {
+                std::this_thread::yield();
+                continue;
+            }
+            // releases discovered here are pushed (and counted) before this one is uncounted
+            cb->release();
+            m_pending.fetch_sub(1, std::memory_order_release);
+        }
+        cur = nullptr;
+    }
+
+    std::unique_ptr<impl::teardown_worker[]> m_workers;
+    unsigned m_num_workers;
+    std::vector<std::thread> m_threads;
+
+    alignas(impl::cache_line_size) std::atomic_size_t m_pending = {0};
+
+    std::mutex m_release_mutex; // a single release runs at a time
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_done_cv;
+    uint64_t m_generation = 0;
+    unsigned m_active = 0;
+    bool m_stop = false;
+};
+
+namespace impl {
+inline void teardown_worker::push(teardown_control_block* cb) noexcept {
+    pool->m_pending.fetch_add(1, std::memory_order_relaxed);
+    spinlock::lock_guard _l(lock);
+    cb->next = head;
+    head = cb;
+    ++size;
+}
+
+inline teardown_control_block* teardown_worker::pop() noexcept {
+    spinlock::lock_guard _l(lock);
+    auto ret = head;
+    if (ret) {
+        head = ret->next;
+        --size;
+    }
+    return ret;
+}
+
+inline bool teardown_worker::steal_from(teardown_worker& victim) noexcept {
+    teardown_control_block* stolen;
+    size_t n;
+    {
+        spinlock::lock_guard _l(victim.lock);
+        if (!victim.size) return false;
+        n = (victim.size + 1) / 2;
+        // take the bottom (oldest) half: these are closer to the roots and likely have more work behind them
+        auto keep = victim.size - n;
+        if (keep == 0) {
+            stolen = victim.head;
+            victim.head = nullptr;
+        }
+        else {
+            auto last_kept = victim.head;
+            for (size_t i = 1; i < keep; ++i) last_kept = last_kept->next;
+            stolen = last_kept->next;
+            last_kept->next = nullptr;
+        }
+        victim.size -= n;
+    }
+    auto tail = stolen;
+    while (tail->next) tail = tail->next;
+    spinlock::lock_guard _l(lock);
+    tail->next = head;
+    head = stolen;
+    size += n;
+    return true;
+}
+}
+
+// destroy the objects of ptrs (and the objects which they hold) with the threads of a pool
+template <typename T>
+void parallel_release(std::vector<teardown_shared_ptr<T>>&& ptrs, release_pool& pool) noexcept {
+    pool.release(std::move(ptrs));
+}
+
+}
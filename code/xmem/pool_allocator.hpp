@@ -0,0 +1,66 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "bits/size_class_pool.hpp"
+
+#include <memory>
+
+namespace xmem {
+
+// A stateless allocator which serves small blocks (up to 512 bytes, aligned to at most 16) from
+// thread-cached size classes. Control blocks with their objects typically fall in these.
+// Larger or overaligned allocations go to operator new.
+// Blocks can be freed from any thread. Pooled memory is never returned to the system.
+// The pool memory comes from ChunkSource (see bits/size_class_pool.hpp)
+template <typename T, typename ChunkSource>
+class basic_pool_allocator {
+public:
+    using value_type = T;
+    using chunk_source = ChunkSource;
+
+    basic_pool_allocator() noexcept = default;
+    basic_pool_allocator(const basic_pool_allocator&) noexcept = default;
+    template <typename U>
+    basic_pool_allocator(const basic_pool_allocator<U, ChunkSource>&) noexcept {}
+
+    template <typename U>
+    struct rebind {
+        using other = basic_pool_allocator<U, ChunkSource>;
+    };
+
+    [[nodiscard]] T* allocate(size_t n) {
+        auto size = n * sizeof(T);
+        if (impl::size_classes::fits(size, alignof(T))) {
+            return static_cast<T*>(impl::size_class_allocate<ChunkSource>(size));
+        }
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return static_cast<T*>(::operator new(size, std::align_val_t{alignof(T)}));
+        }
+        else {
+            return static_cast<T*>(::operator new(size));
+        }
+    }
+    void deallocate(T* ptr, size_t n) noexcept {
+        auto size = n * sizeof(T);
+        if (impl::size_classes::fits(size, alignof(T))) {
+            impl::size_class_deallocate<ChunkSource>(ptr, size);
+        }
+        else if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(ptr, std::align_val_t{alignof(T)});
+        }
+        else {
+            ::operator delete(ptr);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const basic_pool_allocator<U, ChunkSource>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const basic_pool_allocator<U, ChunkSource>&) const noexcept { return false; }
+};
+
+template <typename T>
+using pool_allocator = basic_pool_allocator<T, impl::new_chunk_source>;
+
+}
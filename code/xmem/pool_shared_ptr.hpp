@@ -0,0 +1,22 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "shared_ptr.hpp"
+#include "local_shared_ptr.hpp"
+#include "pool_allocator.hpp"
+
+namespace xmem {
+
+// the control block and the object are allocated from the thread-cached pools of pool_allocator
+template <typename T, typename... Args>
+[[nodiscard]] shared_ptr<T> make_pool_shared(Args&&... args) {
+    return shared_ptr<T>(atomic_control_block_factory::make_resource_cb<T>(pool_allocator<char>{}, std::forward<Args>(args)...));
+}
+
+template <typename T, typename... Args>
+[[nodiscard]] local_shared_ptr<T> make_local_pool_shared(Args&&... args) {
+    return local_shared_ptr<T>(local_control_block_factory::make_resource_cb<T>(pool_allocator<char>{}, std::forward<Args>(args)...));
+}
+
+}
@@ -0,0 +1,182 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "common_control_block.hpp"
+#include "basic_shared_ptr.hpp"
+#include "basic_weak_ptr.hpp"
+#include "control_block_deleter.hpp"
+#include "unique_ptr.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+namespace xmem {
+
+// Relocation: moving an object to a new address and ending the lifetime of the source
+// For trivially relocatable types this is a memcpy, instead of a move construction and a destruction
+
+// specialize for types which can be relocated with memcpy
+template <typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+namespace impl {
+template <typename MemFn>
+struct member_class {};
+template <typename C, typename R, typename... Args>
+struct member_class<R (C::*)(Args...)> { using type = C; };
+template <typename C, typename R, typename... Args>
+struct member_class<R (C::*)(Args...) noexcept> { using type = C; };
+
+template <typename C>
+struct is_control_block_base : std::false_type {};
+template <typename RC>
+struct is_control_block_base<control_block_base<RC>> : std::true_type {};
+
+template <typename MemFn>
+inline constexpr bool is_control_block_base_member = is_control_block_base<typename member_class<MemFn>::type>::value;
+
+template <typename CB>
+inline constexpr bool has_batched_transfer =
+    is_control_block_base_member<decltype(&CB::transfer_strong)> == is_control_block_base_member<decltype(&CB::transfer_strong_n)>
+    && is_control_block_base_member<decltype(&CB::transfer_weak)> == is_control_block_base_member<decltype(&CB::transfer_weak_n)>;
+
+// call transfer(cb, i, count) once for each run of consecutive elements with the same control block
+template <typename CBAt, typename Transfer>
+void for_each_cb_run(size_t n, CBAt cb_at, Transfer transfer) noexcept {
+    for (size_t i = 0; i < n; ) {
+        auto cb = cb_at(i);
+        size_t end = i + 1;
+        while (end < n && cb_at(end) == cb) ++end;
+        if (cb) transfer(cb, i, end - i);
+        i = end;
+    }
+}
+}
+
+// whether the transfer hooks of a control block type are the no-op ones of control_block_base
+// pointers to such control blocks don't care about their own addresses
+template <typename CB>
+struct has_noop_transfer : std::bool_constant<
+    impl::is_control_block_base_member<decltype(&CB::transfer_strong)>
+    && impl::is_control_block_base_member<decltype(&CB::transfer_weak)>
+> {
+    static_assert(impl::has_batched_transfer<CB>, "control blocks which override transfer hooks must override their _n variants too");
+};
+
+template <typename CB>
+inline constexpr bool has_noop_transfer_v = has_noop_transfer<CB>::value;
+
+// How a type is relocated
+// If bitwise is true, a range is relocated with memcpy, after which fixup(dst, src, n) is called
+// (with src still intact). Otherwise objects are move-constructed and destroyed one by one.
+template <typename T>
+struct relocation_traits {
+    static inline constexpr bool bitwise = is_trivially_relocatable_v<T>;
+    static void fixup(T*, const T*, size_t) noexcept {}
+};
+
+// Shared and weak pointers are always relocated bitwise
+// Control blocks which track their refs get a transfer_*_n call for each run of relocated pointers
+// to the same control block (a single call if the entire range points to the same one)
+template <typename CBF, typename T>
+struct is_trivially_relocatable<basic_shared_ptr<CBF, T>> : has_noop_transfer<typename CBF::cb_type> {};
+
+template <typename CBF, typename T>
+struct relocation_traits<basic_shared_ptr<CBF, T>> {
+    static inline constexpr bool bitwise = true;
+    static void fixup(basic_shared_ptr<CBF, T>* dst, const basic_shared_ptr<CBF, T>* src, size_t n) noexcept {
+        if constexpr (!has_noop_transfer_v<typename CBF::cb_type>) {
+            impl::for_each_cb_run(n, [&](size_t i) { return dst[i].m.cb; }, [&](auto cb, size_t i, size_t count) {
+                cb->transfer_strong_n(dst + i, src + i, count, sizeof(*dst));
+            });
+        }
+    }
+};
+
+template <typename CBF, typename T>
+struct is_trivially_relocatable<basic_weak_ptr<CBF, T>> : has_noop_transfer<typename CBF::cb_type> {};
+
+template <typename CBF, typename T>
+struct relocation_traits<basic_weak_ptr<CBF, T>> {
+    static inline constexpr bool bitwise = true;
+    static void fixup(basic_weak_ptr<CBF, T>* dst, const basic_weak_ptr<CBF, T>* src, size_t n) noexcept {
+        if constexpr (!has_noop_transfer_v<typename CBF::cb_type>) {
+            impl::for_each_cb_run(n, [&](size_t i) { return dst[i].m.cb; }, [&](auto cb, size_t i, size_t count) {
+                cb->transfer_weak_n(dst + i, src + i, count, sizeof(*dst));
+            });
+        }
+    }
+};
+
+template <typename CBF>
+struct is_trivially_relocatable<control_block_deleter<CBF>> : has_noop_transfer<typename CBF::cb_type> {};
+
+template <typename CBF>
+struct relocation_traits<control_block_deleter<CBF>> {
+    static inline constexpr bool bitwise = true;
+    static void fixup(control_block_deleter<CBF>* dst, const control_block_deleter<CBF>* src, size_t n) noexcept {
+        if constexpr (!has_noop_transfer_v<typename CBF::cb_type>) {
+            impl::for_each_cb_run(n, [&](size_t i) { return dst[i].m_cb; }, [&](auto cb, size_t i, size_t count) {
+                cb->transfer_strong_n(dst + i, src + i, count, sizeof(*dst));
+            });
+        }
+    }
+};
+
+// unique pointers are relocated like their deleters (references and function pointers are trivial)
+// (deleters which own control blocks are batched as above, with the stride of the unique pointer)
+template <typename T, typename D>
+struct is_trivially_relocatable<unique_ptr<T, D>>
+    : std::bool_constant<std::is_reference_v<D> || is_trivially_relocatable_v<D>> {};
+
+template <typename T, typename D>
+struct relocation_traits<unique_ptr<T, D>> {
+    static inline constexpr bool bitwise = std::is_reference_v<D> || relocation_traits<D>::bitwise;
+    static void fixup(unique_ptr<T, D>* dst, const unique_ptr<T, D>* src, size_t n) noexcept {
+        if constexpr (!std::is_reference_v<D> && !is_trivially_relocatable_v<D>) {
+            for (size_t i = 0; i < n; ++i) {
+                relocation_traits<D>::fixup(&dst[i].get_deleter(), &src[i].get_deleter(), 1);
+            }
+        }
+    }
+};
+
+template <typename T, typename CBF>
+struct relocation_traits<unique_ptr<T, control_block_deleter<CBF>>> {
+    static inline constexpr bool bitwise = true;
+    static void fixup(unique_ptr<T, control_block_deleter<CBF>>* dst, const unique_ptr<T, control_block_deleter<CBF>>* src, size_t n) noexcept {
+        if constexpr (!has_noop_transfer_v<typename CBF::cb_type>) {
+            impl::for_each_cb_run(n, [&](size_t i) { return dst[i].get_deleter().m_cb; }, [&](auto cb, size_t i, size_t count) {
+                cb->transfer_strong_n(&dst[i].get_deleter(), &src[i].get_deleter(), count, sizeof(*dst));
+            });
+        }
+    }
+};
+
+// relocate [first, last) to the uninitialized memory at dst (the ranges must not overlap)
+// afterwards [first, last) is uninitialized memory
+// returns the end of the destination range
+// the move constructors of types which are not relocated bitwise must not throw
+template <typename T>
+T* uninitialized_relocate(T* first, T* last, T* dst) noexcept {
+    auto n = size_t(last - first);
+    if constexpr (relocation_traits<T>::bitwise) {
+        if (n) {
+            std::memcpy(static_cast<void*>(dst), static_cast<const void*>(first), n * sizeof(T));
+            relocation_traits<T>::fixup(dst, first, n);
+        }
+    }
+    else {
+        for (size_t i = 0; i < n; ++i) {
+            new (dst + i) T(std::move(first[i]));
+            first[i].~T();
+        }
+    }
+    return dst + n;
+}
+
+}
@@ -37,6 +37,52 @@ template <typename T>
     return shared_ptr<T>(atomic_control_block_factory::make_resource_cb_for_overwrite<T>(allocator<char>{}));
 }
 
+template <typename T>
+[[nodiscard]] shared_ptr<T> make_shared_for_overwrite(size_t n) {
+    return shared_ptr<T>(atomic_control_block_factory::make_resource_cb_for_overwrite<T>(allocator<char>{}, n));
+}
+
+// the object is allocated separately from the control block, so weak pointers don't keep its memory
+// (make_shared does this for types with split_allocation)
+template <typename T, typename... Args>
+[[nodiscard]] shared_ptr<T> make_shared_split(Args&&... args) {
+    return shared_ptr<T>(atomic_control_block_factory::make_split_resource_cb<T>(allocator<char>{}, std::forward<Args>(args)...));
+}
+
+// the control block and the object are allocated with a copy of a (rebound as needed)
+template <typename T, typename Alloc, typename... Args>
+[[nodiscard]] shared_ptr<T> allocate_shared(const Alloc& a, Args&&... args) {
+    return shared_ptr<T>(atomic_control_block_factory::make_resource_cb<T>(a, std::forward<Args>(args)...));
+}
+
+template <typename T, typename Alloc>
+[[nodiscard]] shared_ptr<T> allocate_shared_for_overwrite(const Alloc& a) {
+    return shared_ptr<T>(atomic_control_block_factory::make_resource_cb_for_overwrite<T>(a));
+}
+
+template <typename T, typename Alloc>
+[[nodiscard]] shared_ptr<T> allocate_shared_for_overwrite(const Alloc& a, size_t n) {
+    return shared_ptr<T>(atomic_control_block_factory::make_resource_cb_for_overwrite<T>(a, n));
+}
+
+// a unique_ptr whose object is in a control block, so it can be converted to shared_ptr without an allocation
+template <typename T>
+using unique_shareable_ptr = unique_ptr<T, control_block_deleter<atomic_control_block_factory>>;
+
+template <typename T, typename... Args>
+[[nodiscard]] unique_shareable_ptr<T> make_unique_shareable(Args&&... args) {
+    static_assert(!std::is_array_v<T>, "arrays are not supported");
+    return control_block_deleter<atomic_control_block_factory>::make_unique(
+        atomic_control_block_factory::make_resource_cb<T>(allocator<char>{}, std::forward<Args>(args)...));
+}
+
+// an object followed by count value-initialized elements of E in the same allocation
+// the object is constructed with (trailing_span<E>, args...)
+template <typename T, typename E, typename... Args>
+[[nodiscard]] shared_ptr<T> make_shared_with_trailing(size_t count, Args&&... args) {
+    return shared_ptr<T>(atomic_control_block_factory::make_trailing_resource_cb<T, E>(allocator<char>{}, count, std::forward<Args>(args)...));
+}
+
 template <typename T>
 using atomic_shared_ptr_storage = basic_atomic_shared_ptr_storage<atomic_control_block_factory, T>;
 
@@ -0,0 +1,27 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "shared_ptr.hpp"
+#include "local_shared_ptr.hpp"
+#include "basic_thin_shared_ptr.hpp"
+
+namespace xmem {
+
+template <typename T>
+using thin_shared_ptr = basic_thin_shared_ptr<atomic_control_block_factory, T>;
+
+template <typename T, typename... Args>
+[[nodiscard]] thin_shared_ptr<T> make_thin_shared(Args&&... args) {
+    return thin_shared_ptr<T>(atomic_control_block_factory::make_thin_cb<T>(allocator<char>{}, std::forward<Args>(args)...));
+}
+
+template <typename T>
+using local_thin_shared_ptr = basic_thin_shared_ptr<local_control_block_factory, T>;
+
+template <typename T, typename... Args>
+[[nodiscard]] local_thin_shared_ptr<T> make_local_thin_shared(Args&&... args) {
+    return local_thin_shared_ptr<T>(local_control_block_factory::make_thin_cb<T>(allocator<char>{}, std::forward<Args>(args)...));
+}
+
+}
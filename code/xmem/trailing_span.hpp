@@ -0,0 +1,32 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include <cstddef>
+
+namespace xmem {
+
+// a view of the elements placed after an object in the same allocation
+// (see make_shared_with_trailing)
+// it's passed as the first argument to the constructor of the object
+template <typename E>
+class trailing_span {
+    E* m_data = nullptr;
+    size_t m_size = 0;
+public:
+    using element_type = E;
+
+    trailing_span() noexcept = default;
+    trailing_span(E* data, size_t size) noexcept : m_data(data), m_size(size) {}
+
+    [[nodiscard]] E* data() const noexcept { return m_data; }
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+
+    [[nodiscard]] E& operator[](size_t i) const noexcept { return m_data[i]; }
+
+    [[nodiscard]] E* begin() const noexcept { return m_data; }
+    [[nodiscard]] E* end() const noexcept { return m_data + m_size; }
+};
+
+}
@@ -97,7 +97,13 @@ public:
         }
     }
 
-    void swap(unique_ptr& other) { common::swap(other); }
+    void swap(unique_ptr& other) {
+        common::swap(other);
+        if constexpr (std::is_move_assignable_v<D>) {
+            using std::swap;
+            swap(get_deleter(), other.get_deleter());
+        }
+    }
     using common::release;
     using common::operator bool;
     using common::get;
@@ -282,7 +288,13 @@ public:
         }
     }
 
-    void swap(unique_ptr& other) { common::swap(other); }
+    void swap(unique_ptr& other) {
+        common::swap(other);
+        if constexpr (std::is_move_assignable_v<D>) {
+            using std::swap;
+            swap(get_deleter(), other.get_deleter());
+        }
+    }
     using common::release;
     using common::operator bool;
     using common::get;
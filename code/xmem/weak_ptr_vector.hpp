@@ -0,0 +1,200 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#pragma once
+#include "shared_ptr.hpp"
+#include "local_shared_ptr.hpp"
+#include "allocator.hpp"
+#include "bulk.hpp"
+#include "bits/prefetch.hpp"
+
+#include <new>
+#include <utility>
+
+namespace xmem {
+
+// A vector of weak references (say the subscribers of an event)
+// It stores a packed array of control block and object pointers. Expired entries are removed while
+// iterating and when it needs to grow, so it doesn't grow with dead entries and the removal is
+// amortized over the pushes.
+// The entries are not ordered (removal moves entries).
+// The container itself is not synchronized. The thread-safe variant only means atomic ref counts.
+template <typename CBF, typename T>
+class basic_weak_ptr_vector {
+public:
+    using element_type = std::remove_extent_t<T>;
+    using control_block_type = typename CBF::cb_type;
+    using cb_ptr_pair_type = cb_ptr_pair<control_block_type, element_type>;
+    using shared_ptr_type = basic_shared_ptr<CBF, T>;
+
+    basic_weak_ptr_vector() noexcept = default;
+
+    basic_weak_ptr_vector(const basic_weak_ptr_vector&) = delete;
+    basic_weak_ptr_vector& operator=(const basic_weak_ptr_vector&) = delete;
+
+    // the entries don't move, so no transfer of refs is needed
+    basic_weak_ptr_vector(basic_weak_ptr_vector&& r) noexcept
+        : m_data(r.m_data)
+        , m_size(r.m_size)
+        , m_capacity(r.m_capacity)
+    {
+        r.m_data = nullptr;
+        r.m_size = r.m_capacity = 0;
+    }
+    basic_weak_ptr_vector& operator=(basic_weak_ptr_vector&& r) noexcept {
+        if (&r == this) return *this; // self usurp
+        free();
+        m_data = r.m_data;
+        m_size = r.m_size;
+        m_capacity = r.m_capacity;
+        r.m_data = nullptr;
+        r.m_size = r.m_capacity = 0;
+        return *this;
+    }
+
+    ~basic_weak_ptr_vector() {
+        free();
+    }
+
+    // add a weak ref to the object of a shared or weak pointer (null pointers are not added)
+    template <typename U>
+    void push_back(const basic_shared_ptr<CBF, U>& ptr) {
+        push(ptr.m);
+    }
+    template <typename U>
+    void push_back(const basic_weak_ptr<CBF, U>& ptr) {
+        push(ptr.m);
+    }
+
+    // remove the entries with the owner of ptr
+    // returns the number of removed entries
+    template <typename Ptr>
+    size_t erase(const Ptr& ptr) noexcept {
+        auto owner = ptr.owner();
+        return remove_if([owner](const cb_ptr_pair_type& e) { return e.cb == owner; });
+    }
+
+    // remove the expired entries
+    // returns the number of removed entries
+    size_t compact() noexcept {
+        return remove_if([](const cb_ptr_pair_type& e) { return e.cb->strong_ref_count() == 0; });
+    }
+
+    // call f(const shared_ptr_type&) for each non-expired entry, locking it once,
+    // and remove the expired entries on the way
+    // f (or the destructors of objects released by it) must not modify the vector
+    // returns the number of entries which were alive
+    template <typename F>
+    size_t for_each_alive(F&& f) {
+        size_t alive = 0;
+        size_t i = 0;
+        try {
+            for (; i < m_size; ++i) {
+                if (i + default_prefetch_distance < m_size) {
+                    impl::prefetch_for_write(m_data[i + default_prefetch_distance].cb);
+                }
+                auto& e = m_data[i];
+                shared_ptr_type locked;
+                if (!e.cb->inc_strong_ref_nz(&locked)) {
+                    e.cb->dec_weak_ref(&e);
+                    continue;
+                }
+                locked.m = e;
+                if (alive != i) move_entry(alive, i);
+                ++alive;
+                f(std::as_const(locked));
+            }
+        }
+        catch (...) {
+            // close the gap of removed entries before the rest
+            while (++i < m_size) {
+                move_entry(alive++, i);
+            }
+            m_size = alive;
+            throw;
+        }
+        m_size = alive;
+        return alive;
+    }
+
+    // the number of entries (including expired ones which haven't been removed yet)
+    [[nodiscard]] size_t size() const noexcept { return m_size; }
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    [[nodiscard]] size_t capacity() const noexcept { return m_capacity; }
+
+    void clear() noexcept {
+        for (size_t i = 0; i < m_size; ++i) {
+            m_data[i].cb->dec_weak_ref(m_data + i);
+        }
+        m_size = 0;
+    }
+
+private:
+    cb_ptr_pair_type* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+
+    template <typename U>
+    void push(const cb_ptr_pair<control_block_type, U>& p) {
+        if (!p.cb) return;
+        if (m_size == m_capacity) {
+            compact();
+            // grow only if the vector is at least half full, so there are at least capacity/2 pushes
+            // between compactions
+            if (m_size >= m_capacity / 2) {
+                grow(m_capacity ? m_capacity * 2 : 8);
+            }
+        }
+        auto e = new (m_data + m_size) cb_ptr_pair_type(p);
+        e->cb->inc_weak_ref(e);
+        ++m_size;
+    }
+
+    void grow(size_t capacity) {
+        auto data = allocator<cb_ptr_pair_type>{}.allocate(capacity);
+        for (size_t i = 0; i < m_size; ++i) {
+            new (data + i) cb_ptr_pair_type(m_data[i]);
+            data[i].cb->transfer_weak(data + i, m_data + i);
+        }
+        if (m_data) allocator<cb_ptr_pair_type>{}.deallocate(m_data, m_capacity);
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+    void move_entry(size_t to, size_t from) noexcept {
+        m_data[to] = m_data[from];
+        m_data[to].cb->transfer_weak(m_data + to, m_data + from);
+    }
+
+    template <typename Pred>
+    size_t remove_if(Pred pred) noexcept {
+        size_t kept = 0;
+        for (size_t i = 0; i < m_size; ++i) {
+            auto& e = m_data[i];
+            if (pred(e)) {
+                e.cb->dec_weak_ref(&e);
+                continue;
+            }
+            if (kept != i) move_entry(kept, i);
+            ++kept;
+        }
+        auto ret = m_size - kept;
+        m_size = kept;
+        return ret;
+    }
+
+    void free() noexcept {
+        clear();
+        if (m_data) allocator<cb_ptr_pair_type>{}.deallocate(m_data, m_capacity);
+        m_data = nullptr;
+        m_capacity = 0;
+    }
+};
+
+template <typename T>
+using weak_ptr_vector = basic_weak_ptr_vector<atomic_control_block_factory, T>;
+
+template <typename T>
+using local_weak_ptr_vector = basic_weak_ptr_vector<local_control_block_factory, T>;
+
+}
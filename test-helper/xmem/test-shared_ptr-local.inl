@@ -180,6 +180,58 @@ STD20(TEST_CASE("make_shared_for_overwrite") {
     CHECK(op->a == 11);
 })
 
+STD20(TEST_CASE("make_shared array") {
+    obj::lifetime_stats stats;
+
+    {
+        auto ar = test::make_test_shared<obj[]>(3);
+        CHECK(stats.living == 3);
+        for (int i = 0; i < 3; ++i) {
+            CHECK(ar[i].a == 11);
+        }
+        CHECK(ar.use_count() == 1);
+
+        auto ar2 = test::make_test_shared<obj[]>(2, obj(5, "five"));
+        CHECK(ar2[0].a == 5);
+        CHECK(ar2[1].b == "five");
+
+        test::test_shared_ptr<obj[5]> bar = test::make_test_shared<obj[5]>();
+        CHECK(bar[4].a == 11);
+        auto bar2 = test::make_test_shared<obj[2]>(obj(3));
+        CHECK(bar2[1].a == 3);
+
+        auto iar = test::make_test_shared<int[]>(4);
+        CHECK(iar[3] == 0); // value-initialized
+
+        auto ear = test::make_test_shared<obj[]>(0);
+        CHECK(ear.use_count() == 1);
+
+        test::test_shared_ptr<obj> alias(ar, &ar[1]);
+        ar.reset();
+        CHECK(stats.living == 3 + 2 + 5 + 2);
+        alias.reset();
+        CHECK(stats.living == 2 + 5 + 2);
+    }
+    CHECK(stats.living == 0);
+
+    auto far = test::make_test_shared_for_overwrite<obj[]>(2);
+    CHECK(far[1].a == 11);
+    auto fbar = test::make_test_shared_for_overwrite<int[3]>();
+    CHECK(fbar);
+})
+
+TEST_CASE("shared_ptr: raw array") {
+    obj::lifetime_stats stats;
+    {
+        test::test_shared_ptr<obj[]> ar(new obj[3]);
+        CHECK(ar[2].a == 11);
+        ar.reset(new obj[2]);
+        CHECK(stats.living == 2);
+    }
+    CHECK(stats.total == 5);
+    CHECK(stats.living == 0);
+}
+
 TEST_CASE("make_shared_ptr") {
     std::vector<int> vec = {1, 2, 3};
     auto copy = xtest::make_test_shared_ptr(vec);
@@ -0,0 +1,169 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/shared_ptr.hpp>
+#include <xmem/local_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+
+#if __has_include(<memory_resource>)
+#   include <memory_resource>
+#endif
+
+TEST_SUITE_BEGIN("allocate_shared");
+
+namespace {
+struct alloc_stats {
+    int allocs = 0;
+    int deallocs = 0;
+    bool fail = false;
+};
+
+// stateful allocator which counts in an external stats object
+template <typename T>
+struct stats_allocator {
+    using value_type = T;
+
+    alloc_stats* stats;
+
+    explicit stats_allocator(alloc_stats& s) noexcept : stats(&s) {}
+    template <typename U>
+    stats_allocator(const stats_allocator<U>& other) noexcept : stats(other.stats) {}
+
+    T* allocate(size_t n) {
+        if (stats->fail) throw std::bad_alloc();
+        ++stats->allocs;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) {
+        ++stats->deallocs;
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+struct cnt_deleter {
+    int dels = 0;
+    void operator()(int* iptr) {
+        ++dels;
+        delete iptr;
+    }
+};
+}
+
+TEST_CASE("allocate_shared") {
+    obj::lifetime_stats ostats;
+    alloc_stats astats;
+    stats_allocator<obj> a(astats);
+
+    {
+        auto p = xmem::allocate_shared<obj>(a, 5, "five");
+        CHECK(p->a == 5);
+        CHECK(p->b == "five");
+        CHECK(astats.allocs == 1);
+
+        xmem::weak_ptr<obj> w = p;
+        p.reset();
+        CHECK(ostats.living == 0);
+        CHECK(astats.deallocs == 0);
+    }
+    CHECK(astats.deallocs == 1);
+
+    {
+        auto lp = xmem::allocate_local_shared<child>(a, 1, 2);
+        CHECK(lp->val() == 3);
+        auto ow = xmem::allocate_local_shared_for_overwrite<int>(a);
+        CHECK(ow);
+        auto ar = xmem::allocate_shared<obj[]>(a, 3, obj(7));
+        CHECK(ar[2].a == 7);
+        auto oar = xmem::allocate_shared_for_overwrite<int[]>(a, 10);
+        CHECK(oar);
+        CHECK(astats.allocs == 5);
+    }
+    CHECK(astats.deallocs == 5);
+    CHECK(ostats.living == 0);
+}
+
+TEST_CASE("array size overflow") {
+    constexpr size_t huge = SIZE_MAX / sizeof(uint64_t) + 2; // the size in bytes wraps
+    CHECK_THROWS_AS((void)(xmem::make_shared<uint64_t[]>(huge)), std::bad_array_new_length);
+    CHECK_THROWS_AS((void)(xmem::make_local_shared<uint64_t[]>(huge)), std::bad_array_new_length);
+
+    alloc_stats stats;
+    CHECK_THROWS_AS((void)(xmem::allocate_shared<uint64_t[]>(stats_allocator<char>(stats), huge)), std::bad_array_new_length);
+    CHECK_THROWS_AS((void)(xmem::allocate_shared<uint64_t[]>(stats_allocator<char>(stats), SIZE_MAX)), std::bad_array_new_length);
+    CHECK(stats.allocs == 0);
+}
+
+TEST_CASE("shared_ptr with deleter and allocator") {
+    alloc_stats astats;
+    stats_allocator<char> a(astats);
+    cnt_deleter d;
+
+    {
+        xmem::shared_ptr<int> p(new int(4), std::ref(d), a);
+        CHECK(*p == 4);
+        CHECK(astats.allocs == 1);
+
+        p.reset(new int(5), std::ref(d), a);
+        CHECK(*p == 5);
+        CHECK(d.dels == 1);
+        CHECK(astats.allocs == 2);
+        CHECK(astats.deallocs == 1);
+
+        xmem::local_shared_ptr<int> e(nullptr, std::ref(d), a);
+        CHECK_FALSE(e);
+        CHECK(e.use_count() == 1);
+    }
+    CHECK(d.dels == 2); // the deleter is not called for null
+    CHECK(astats.deallocs == 3);
+
+    // the deleter is called if the allocation fails
+    astats.fail = true;
+    CHECK_THROWS_AS(xmem::shared_ptr<int>(new int(6), std::ref(d), a), std::bad_alloc);
+    CHECK(d.dels == 3);
+
+    xmem::shared_ptr<int> keep(new int(7));
+    CHECK_THROWS_AS(keep.reset(new int(8), std::ref(d), a), std::bad_alloc);
+    CHECK(d.dels == 4);
+    CHECK(*keep == 7); // unchanged
+}
+
+#if defined(__cpp_lib_memory_resource)
+TEST_CASE("pmr") {
+    obj::lifetime_stats ostats;
+    alignas(64) char buf[1024];
+    std::pmr::monotonic_buffer_resource mono(buf, sizeof(buf), std::pmr::null_memory_resource());
+    std::pmr::polymorphic_allocator<char> a(&mono);
+
+    auto in_buf = [&](const void* p) {
+        auto c = static_cast<const char*>(p);
+        return c >= buf && c < buf + sizeof(buf);
+    };
+
+    {
+        auto p = xmem::allocate_shared<obj>(a, 1, "one");
+        CHECK(in_buf(p.get()));
+        CHECK(in_buf(p.t_owner()));
+
+        auto lp = xmem::allocate_local_shared<avx_512>(a);
+        CHECK(in_buf(lp.get()));
+        CHECK(reinterpret_cast<uintptr_t>(lp.get()) % 64 == 0);
+
+        auto ar = xmem::allocate_shared<int[]>(a, 10, 3);
+        CHECK(in_buf(ar.get()));
+        CHECK(ar[9] == 3);
+
+        std::pmr::unsynchronized_pool_resource pool;
+        xmem::shared_ptr<int> dp(new int(4), std::default_delete<int>{}, std::pmr::polymorphic_allocator<int>(&pool));
+        CHECK(*dp == 4);
+    }
+    CHECK(ostats.living == 0);
+
+    CHECK_THROWS_AS(xmem::allocate_shared<int[]>(a, 1000), std::bad_alloc);
+}
+#endif
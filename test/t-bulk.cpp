@@ -0,0 +1,90 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/bulk.hpp>
+#include <xmem/shared_ptr.hpp>
+#include <xmem/local_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <vector>
+
+TEST_SUITE_BEGIN("bulk");
+
+TEST_CASE("reset_all") {
+    obj::lifetime_stats stats;
+    {
+        std::vector<xmem::shared_ptr<obj>> ptrs;
+        for (int i = 0; i < 100; ++i) {
+            ptrs.push_back(xmem::make_shared<obj>(i));
+        }
+        ptrs.emplace_back(); // null
+        ptrs.push_back(ptrs[5]); // same owner twice
+        auto keep = ptrs[7];
+
+        xmem::reset_all(ptrs.data(), ptrs.size());
+        for (auto& p : ptrs) CHECK_FALSE(p);
+        CHECK(stats.living == 1);
+        CHECK(keep->a == 7);
+
+        // no prefetching and a distance larger than the range
+        std::vector<xmem::local_shared_ptr<int>> lptrs(3, xmem::make_local_shared<int>(3));
+        xmem::reset_all(lptrs.data(), 2, 0);
+        CHECK(lptrs[2].use_count() == 1);
+        xmem::reset_all(lptrs.data(), lptrs.size(), 100);
+        CHECK_FALSE(lptrs[2]);
+
+        xmem::reset_all(lptrs.data(), 0);
+    }
+    CHECK(stats.living == 0);
+}
+
+TEST_CASE("lock_all") {
+    std::vector<xmem::shared_ptr<int>> strong;
+    std::vector<xmem::weak_ptr<int>> weak;
+    for (int i = 0; i < 50; ++i) {
+        strong.push_back(xmem::make_shared<int>(i));
+        weak.push_back(strong.back());
+    }
+    weak.emplace_back();
+    for (size_t i = 0; i < strong.size(); i += 3) {
+        strong[i].reset();
+    }
+
+    auto marker = xmem::make_shared<int>(-1);
+    std::vector<xmem::shared_ptr<int>> out(weak.size(), marker);
+    auto n = xmem::lock_all(weak.data(), weak.size(), out.data());
+    CHECK(n == 33);
+    size_t i = 0;
+    for (int v = 0; v < 50; ++v) {
+        if (v % 3 == 0) continue;
+        REQUIRE(out[i]);
+        CHECK(*out[i] == v);
+        CHECK(out[i].use_count() == 2);
+        ++i;
+    }
+    CHECK(i == n);
+    CHECK_FALSE(out[n]); // the trailing null
+    for (i = n + 1; i < out.size(); ++i) {
+        CHECK(out[i] == marker);
+    }
+
+    // all expired and no prefetching
+    strong.clear();
+    out.assign(out.size(), marker);
+    CHECK(xmem::lock_all(weak.data(), weak.size(), out.data(), 0) == 0);
+    CHECK_FALSE(out[0]);
+    CHECK(out[1] == marker);
+
+    CHECK(xmem::lock_all(weak.data(), 0, out.data()) == 0);
+
+    // a null alias of a live object is locked
+    auto owner = xmem::make_shared<int>(7);
+    xmem::weak_ptr<int> null_alias = xmem::shared_ptr<int>(owner, static_cast<int*>(nullptr));
+    CHECK(xmem::lock_all(&null_alias, 1, out.data()) == 1);
+    CHECK_FALSE(out[0]);
+    CHECK(out[0].owner() == owner.owner());
+    CHECK(owner.use_count() == 2);
+}
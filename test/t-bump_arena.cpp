@@ -0,0 +1,73 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/arena_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <cstring>
+
+TEST_SUITE_BEGIN("bump_arena");
+
+TEST_CASE("bump_arena") {
+    xmem::bump_arena arena(256);
+    CHECK(arena.used() == 0);
+
+    auto a = static_cast<char*>(arena.allocate(10, 1));
+    auto b = static_cast<char*>(arena.allocate(8, 8));
+    CHECK(b >= a + 10);
+    CHECK(reinterpret_cast<uintptr_t>(b) % 8 == 0);
+    auto c = arena.allocate(64, 64);
+    CHECK(reinterpret_cast<uintptr_t>(c) % 64 == 0);
+
+    // bigger than a chunk
+    auto big = static_cast<char*>(arena.allocate(1000));
+    memset(big, 0, 1000);
+    CHECK(arena.used() >= 1082);
+
+    CHECK(arena.live() == 4);
+    arena.deallocate(a, 10);
+    arena.deallocate(b, 8);
+    arena.deallocate(c, 64);
+    arena.deallocate(big, 1000);
+    CHECK(arena.live() == 0);
+
+    arena.reset();
+    CHECK(arena.used() == 0);
+    auto again = arena.allocate(10, 1);
+    CHECK(arena.used() == 10);
+    arena.deallocate(again, 10);
+}
+
+TEST_CASE("make_local_arena_shared") {
+    obj::lifetime_stats stats;
+    xmem::bump_arena arena;
+
+    for (int request = 0; request < 3; ++request) {
+        {
+            auto c = xmem::make_local_arena_shared<child>(arena, 1, 2);
+            CHECK(c->val() == 3);
+            xmem::local_shared_ptr<obj> o = c;
+            xmem::local_weak_ptr<obj> w = o;
+
+            auto v = xmem::make_local_arena_shared<std::vector<xmem::local_shared_ptr<obj>>>(arena);
+            for (int i = 0; i < 10; ++i) {
+                v->push_back(xmem::make_local_arena_shared<obj>(arena, i));
+            }
+            CHECK(stats.living == 11);
+
+            auto used = arena.used();
+            c.reset();
+            o.reset();
+            CHECK(w.expired());
+            CHECK(stats.living == 10);
+            CHECK(arena.used() == used); // nothing is reclaimed
+            CHECK(arena.live() == 1 + 1 + 10);
+        }
+        CHECK(stats.living == 0);
+        CHECK(arena.live() == 0);
+        arena.reset();
+    }
+}
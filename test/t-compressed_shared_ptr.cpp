@@ -0,0 +1,171 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/compressed_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <cstdint>
+
+TEST_SUITE_BEGIN("compressed_shared_ptr");
+
+struct test_domain {
+    static xmem::offset_arena& arena() {
+        static xmem::offset_arena a(1024 * 1024);
+        return a;
+    }
+};
+
+static_assert(sizeof(xmem::compressed_shared_ptr<test_domain, obj>) == 8);
+static_assert(sizeof(xmem::local_compressed_thin_shared_ptr<test_domain, obj>) == 4);
+
+TEST_CASE("offset_arena") {
+    xmem::offset_arena arena(1024);
+    CHECK(arena.capacity() == 1024);
+    CHECK(arena.to_offset(nullptr) == 0);
+    CHECK_FALSE(arena.from_offset(0));
+
+    auto a = arena.allocate(12);
+    auto b = arena.allocate(12);
+    CHECK(a != b);
+    CHECK(arena.addressable(a));
+    CHECK(arena.to_offset(a) != 0);
+    CHECK(arena.from_offset(arena.to_offset(b)) == b);
+    auto used = arena.used();
+
+    arena.deallocate(a, 12);
+    CHECK(arena.allocate(16) == a); // same size class reused
+    CHECK(arena.used() == used);
+
+    int outside = 0;
+    CHECK_FALSE(arena.addressable(&outside));
+
+    CHECK_THROWS_AS((void)arena.allocate(2048), std::bad_alloc);
+    CHECK_THROWS_AS((void)arena.allocate(xmem::offset_arena::max_capacity + 1), std::bad_alloc);
+    CHECK_THROWS_AS((void)arena.allocate(SIZE_MAX), std::bad_alloc);
+    CHECK(arena.used() == used);
+}
+
+TEST_CASE("compressed_shared_ptr") {
+    obj::lifetime_stats stats;
+
+    auto used = test_domain::arena().used();
+
+    {
+        xmem::compressed_shared_ptr<test_domain, obj> e;
+        CHECK_FALSE(e);
+        CHECK(e.use_count() == 0);
+        CHECK(xmem::no_owner(e));
+
+        auto c = xmem::make_compressed_shared<test_domain, child>(1, 2);
+        CHECK(c->val() == 3);
+        CHECK(c.use_count() == 1);
+        CHECK(test_domain::arena().addressable(c.get()));
+
+        xmem::compressed_shared_ptr<test_domain, obj> o = c;
+        CHECK(o.get() == c.get());
+        CHECK(c.use_count() == 2);
+
+        xmem::compressed_shared_ptr<test_domain, int> alias(c, &c->c);
+        CHECK(*alias == 2);
+        CHECK(c.use_count() == 3);
+
+        xmem::shared_ptr<obj> full = o;
+        CHECK(full.get() == c.get());
+        CHECK(xmem::same_owner(full, xmem::shared_ptr<obj>(c)));
+        CHECK(c.use_count() == 4);
+
+        xmem::compressed_shared_ptr<test_domain, obj> back(full);
+        CHECK(back == o);
+        CHECK(c.use_count() == 5);
+
+        auto moved = std::move(o);
+        CHECK_FALSE(o);
+        CHECK(c.use_count() == 5);
+
+        xmem::weak_ptr<obj> w = full;
+        full.reset();
+        back.reset();
+        moved.reset();
+        alias.reset();
+        CHECK_FALSE(w.expired());
+        c.reset();
+        CHECK(w.expired());
+        CHECK(stats.living == 0);
+    }
+
+    // everything is in the free lists now
+    auto p = xmem::make_compressed_shared<test_domain, child>(3, 4);
+    p.reset();
+    CHECK(test_domain::arena().used() > used);
+    used = test_domain::arena().used();
+    p = xmem::make_compressed_shared<test_domain, child>(3, 4);
+    CHECK(test_domain::arena().used() == used);
+}
+
+namespace {
+struct unaligned {
+    char c = 1;
+    char d = 2;
+};
+struct base_a { int32_t a = 1; };
+struct base_b { int32_t b = 2; };
+struct derived : public base_a, public base_b {};
+}
+
+TEST_CASE("unaligned") {
+    auto u = xmem::make_compressed_shared<test_domain, unaligned>();
+    xmem::compressed_shared_ptr<test_domain, char> c(u, &u->c);
+    CHECK(*c == 1);
+    CHECK(u.use_count() == 2);
+    xmem::compressed_shared_ptr<test_domain, char> d(u, &u->d);
+    CHECK_FALSE(d);
+    CHECK(xmem::no_owner(d));
+    CHECK(u.use_count() == 2);
+
+    auto p = xmem::make_compressed_shared<test_domain, derived>();
+    xmem::compressed_shared_ptr<test_domain, base_a> a = p;
+    CHECK(a->a == 1);
+    xmem::compressed_shared_ptr<test_domain, base_b> b = p;
+    CHECK_FALSE(b); // base_b is at offset 4
+    b = std::move(p);
+    CHECK_FALSE(b);
+    CHECK(p.use_count() == 2);
+
+    auto full = xmem::make_shared<derived>();
+    CHECK_FALSE(xmem::compressed_shared_ptr<test_domain, derived>(full)); // not in the arena
+}
+
+TEST_CASE("compressed_thin_shared_ptr") {
+    obj::lifetime_stats stats;
+
+    {
+        auto t = xmem::make_local_compressed_thin_shared<test_domain, obj>(5, "five");
+        CHECK(t->a == 5);
+        CHECK(t->b == "five");
+        CHECK(t.use_count() == 1);
+
+        auto t2 = t;
+        CHECK(t2 == t);
+        CHECK(t.use_count() == 2);
+
+        xmem::local_compressed_thin_shared_ptr<test_domain, const obj> ct = std::move(t2);
+        CHECK_FALSE(t2);
+        CHECK(ct.get() == t.get());
+
+        xmem::local_shared_ptr<const obj> full = ct;
+        CHECK(full.get() == t.get());
+        CHECK(t.use_count() == 3);
+
+        xmem::local_weak_ptr<const obj> w = full;
+        full.reset();
+        ct.reset();
+        t.reset();
+        CHECK(w.expired());
+    }
+
+    CHECK(stats.total == 1);
+    CHECK(stats.living == 0);
+}
@@ -0,0 +1,97 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/deferred_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("deferred_shared_ptr");
+
+namespace {
+struct node {
+    int id;
+    xmem::deferred_shared_ptr<node> next;
+    explicit node(int id, xmem::deferred_shared_ptr<node> next = {}) : id(id), next(std::move(next)) {}
+};
+}
+
+TEST_CASE("drain") {
+    xmem::flush_reclaim_queue();
+    obj::lifetime_stats stats;
+    auto s0 = xmem::get_reclaim_stats();
+
+    auto p = xmem::make_deferred_shared<obj>(1, "one");
+    xmem::deferred_weak_ptr<obj> w = p;
+    auto p2 = p;
+    p.reset();
+    CHECK(p2->a == 1);
+    p2.reset();
+
+    CHECK(stats.living == 1);
+    CHECK_FALSE(w.lock());
+    CHECK(w.expired());
+
+    auto s1 = xmem::get_reclaim_stats();
+    CHECK(s1.pending == s0.pending + 1);
+    CHECK(s1.peak_pending >= 1);
+
+    CHECK(xmem::drain_reclaim_queue() == 1);
+    CHECK(stats.living == 0);
+
+    auto s2 = xmem::get_reclaim_stats();
+    CHECK(s2.pending == s0.pending);
+    CHECK(s2.reclaimed == s0.reclaimed + 1);
+
+    CHECK(xmem::drain_reclaim_queue() == 0);
+}
+
+TEST_CASE("flush") {
+    xmem::flush_reclaim_queue();
+
+    xmem::deferred_shared_ptr<node> head;
+    for (int i = 0; i < 5; ++i) {
+        head = xmem::make_deferred_shared<node>(i, std::move(head));
+    }
+    CHECK(head->next->id == 3);
+    head.reset();
+
+    // each drain destroys a single node, which releases the next one
+    CHECK(xmem::drain_reclaim_queue() == 1);
+    CHECK(xmem::get_reclaim_stats().pending == 1);
+    CHECK(xmem::flush_reclaim_queue() == 4);
+    CHECK(xmem::get_reclaim_stats().pending == 0);
+}
+
+TEST_CASE("reclaimer thread") {
+    xmem::flush_reclaim_queue();
+    obj::lifetime_stats stats;
+    auto s0 = xmem::get_reclaim_stats();
+
+    {
+        xmem::reclaimer_thread reclaimer(std::chrono::microseconds(100));
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([]() {
+                for (int i = 0; i < 1000; ++i) {
+                    auto p = xmem::make_deferred_shared<obj>(i);
+                    auto p2 = p;
+                    CHECK(p2->a == i);
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+    }
+
+    // stopping the reclaimer flushes the queue
+    CHECK(stats.living == 0);
+    CHECK(stats.total == 4000);
+    auto s1 = xmem::get_reclaim_stats();
+    CHECK(s1.pending == 0);
+    CHECK(s1.reclaimed == s0.reclaimed + 4000);
+}
@@ -0,0 +1,151 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/expiry_listener.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("expiry_listener");
+
+namespace {
+struct counting_listener : public xmem::expiry_listener {
+    int expired = 0;
+    counting_listener() : xmem::expiry_listener([](xmem::expiry_listener& self) noexcept {
+        ++static_cast<counting_listener&>(self).expired;
+    }) {}
+};
+
+// a cache which evicts entries when their objects expire
+struct cache {
+    struct entry : public xmem::local_expiry_listener {
+        cache* owner;
+        int key;
+        xmem::local_expiry_weak_ptr<obj> value;
+        entry(cache* c, int k) : xmem::local_expiry_listener(on_expire), owner(c), key(k) {}
+        static void on_expire(xmem::local_expiry_listener& self) noexcept {
+            auto& e = static_cast<entry&>(self);
+            e.owner->entries.erase(e.key); // destroys the listener
+        }
+    };
+    std::map<int, std::unique_ptr<entry>> entries;
+
+    void add(int key, const xmem::local_expiry_shared_ptr<obj>& value) {
+        auto e = std::make_unique<entry>(this, key);
+        e->value = value;
+        e->listen(value);
+        entries[key] = std::move(e);
+    }
+};
+}
+
+TEST_CASE("basic") {
+    obj::lifetime_stats stats;
+    counting_listener a, b, c;
+
+    auto p = xmem::make_expiry_shared<obj>(1);
+    xmem::expiry_weak_ptr<obj> w = p;
+    CHECK(a.listen(p));
+    CHECK(b.listen(w));
+    CHECK(c.listen(p));
+    CHECK(a.listening());
+    c.unlisten();
+    CHECK_FALSE(c.listening());
+
+    auto p2 = p;
+    p.reset();
+    CHECK(a.expired == 0);
+    p2.reset();
+    CHECK(stats.living == 0);
+    CHECK(a.expired == 1);
+    CHECK(b.expired == 1);
+    CHECK(c.expired == 0);
+    CHECK_FALSE(a.listening());
+
+    // can't listen to expired or null objects
+    CHECK_FALSE(c.listen(w));
+    CHECK_FALSE(c.listen(xmem::expiry_shared_ptr<obj>{}));
+
+    w.reset();
+    // the listeners keep the control block alive until they unlisten
+    CHECK(a.expired == 1);
+}
+
+TEST_CASE("cache eviction") {
+    obj::lifetime_stats stats;
+    cache c;
+    std::vector<xmem::local_expiry_shared_ptr<obj>> objects;
+    for (int i = 0; i < 10; ++i) {
+        objects.push_back(xmem::make_local_expiry_shared<obj>(i));
+        c.add(i, objects.back());
+    }
+    c.add(100, objects[3]); // two entries for the same object
+    CHECK(c.entries.size() == 11);
+
+    objects[3].reset();
+    CHECK(c.entries.size() == 9);
+    CHECK(c.entries.count(3) == 0);
+    CHECK(c.entries.count(100) == 0);
+
+    objects.clear();
+    CHECK(c.entries.empty());
+    CHECK(stats.living == 0);
+
+    // entries removed before expiry
+    auto p = xmem::make_local_expiry_shared<obj>(5);
+    c.add(5, p);
+    c.entries.clear();
+    p.reset();
+    CHECK(stats.living == 0);
+}
+
+TEST_CASE("threads") {
+    for (int round = 0; round < 100; ++round) {
+        counting_listener l1, l2;
+        auto p = xmem::make_expiry_shared<obj>(1);
+        auto p2 = p;
+        CHECK(l1.listen(p));
+        std::thread t([&]() { p2.reset(); });
+        bool listening = l2.listen(p);
+        p.reset();
+        t.join();
+        CHECK(l1.expired == 1);
+        CHECK(l2.expired == int(listening));
+    }
+}
+
+TEST_CASE("unlisten during notification") {
+    struct slow_listener : public xmem::expiry_listener {
+        std::atomic_bool started = false;
+        std::atomic_bool finished = false;
+        slow_listener() : xmem::expiry_listener([](xmem::expiry_listener& self) noexcept {
+            auto& l = static_cast<slow_listener&>(self);
+            l.started = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            l.finished = true;
+        }) {}
+    };
+
+    for (int round = 0; round < 10; ++round) {
+        auto l = std::make_unique<slow_listener>();
+        counting_listener other; // notified after l
+        auto p = xmem::make_expiry_shared<obj>(1);
+        CHECK(other.listen(p));
+        CHECK(l->listen(p));
+        std::thread t([&]() { p.reset(); });
+        while (!l->started) std::this_thread::yield();
+        l->unlisten(); // waits for the callback
+        CHECK(l->finished);
+        l.reset();
+        t.join();
+        CHECK(other.expired == 1);
+    }
+}
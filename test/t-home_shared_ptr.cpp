@@ -0,0 +1,124 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/home_shared_ptr.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("home_shared_ptr");
+
+namespace {
+struct affine {
+    std::thread::id* destroyed_on;
+    explicit affine(std::thread::id& d) : destroyed_on(&d) {}
+    ~affine() { *destroyed_on = std::this_thread::get_id(); }
+};
+
+struct counting_executor final : public xmem::home_executor {
+    std::atomic_int scheduled = {0};
+    void schedule_drain(xmem::home_mailbox&) noexcept override { ++scheduled; }
+};
+}
+
+TEST_CASE("home thread") {
+    counting_executor ex;
+    xmem::home_mailbox mailbox(&ex);
+    CHECK(xmem::home_mailbox::current() == &mailbox);
+
+    std::thread::id d1, d2, d3;
+    auto a = xmem::make_home_shared<affine>(d1);
+    auto b = xmem::make_home_shared<affine>(d2);
+    CHECK(a.t_owner()->mailbox() == &mailbox);
+    xmem::home_weak_ptr<affine> w = a;
+
+    std::thread([&]() {
+        a.reset();
+        b.reset();
+    }).join();
+
+    // not destroyed yet
+    CHECK(d1 == std::thread::id{});
+    CHECK(w.expired());
+    CHECK_FALSE(w.lock());
+    CHECK(ex.scheduled == 1);
+
+    CHECK(mailbox.drain() == 2);
+    CHECK(d1 == std::this_thread::get_id());
+    CHECK(d2 == std::this_thread::get_id());
+    CHECK(mailbox.drain() == 0);
+
+    // released at home: destroyed inline
+    auto c = xmem::make_home_shared<affine>(d3);
+    auto c2 = c;
+    std::thread([&]() { c2.reset(); }).join();
+    c.reset();
+    CHECK(d3 == std::this_thread::get_id());
+    CHECK(ex.scheduled == 1);
+}
+
+TEST_CASE("no mailbox") {
+    CHECK_FALSE(xmem::home_mailbox::current());
+    std::thread::id d, releaser;
+    auto p = xmem::make_home_shared<affine>(d);
+    CHECK_FALSE(p.t_owner()->mailbox());
+    std::thread([&]() {
+        releaser = std::this_thread::get_id();
+        p.reset();
+    }).join();
+    CHECK(d == releaser);
+}
+
+TEST_CASE("event loop") {
+    // a home thread which drains its mailbox when scheduled, and objects released from many threads
+    struct loop_executor final : public xmem::home_executor {
+        std::atomic_bool pending = {false};
+        void schedule_drain(xmem::home_mailbox&) noexcept override { pending = true; }
+    };
+
+    std::atomic_int destroyed_at_home = {0};
+    std::atomic_bool done = {false};
+
+    struct tracked {
+        std::thread::id home = std::this_thread::get_id();
+        std::atomic_int* counter;
+        explicit tracked(std::atomic_int& c) : counter(&c) {}
+        ~tracked() {
+            if (std::this_thread::get_id() == home) ++*counter;
+        }
+    };
+    std::vector<xmem::home_shared_ptr<tracked>> tracked_objects;
+    std::atomic_bool ready = {false};
+
+    std::thread home([&]() {
+        loop_executor ex;
+        xmem::home_mailbox mailbox(&ex);
+        for (int i = 0; i < 400; ++i) {
+            tracked_objects.push_back(xmem::make_home_shared<tracked>(destroyed_at_home));
+        }
+        ready = true;
+        while (!done) {
+            if (ex.pending.exchange(false)) mailbox.drain();
+            std::this_thread::yield();
+        }
+        // the mailbox drains what's left when destroyed
+    });
+
+    while (!ready) std::this_thread::yield();
+    std::vector<std::thread> releasers;
+    for (int t = 0; t < 4; ++t) {
+        releasers.emplace_back([&, t]() {
+            for (int i = t; i < 400; i += 4) {
+                tracked_objects[i].reset();
+            }
+        });
+    }
+    for (auto& t : releasers) t.join();
+    done = true;
+    home.join();
+
+    CHECK(destroyed_at_home == 400);
+}
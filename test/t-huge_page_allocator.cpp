@@ -0,0 +1,63 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/huge_page_allocator.hpp>
+#include <xmem/shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <vector>
+
+TEST_SUITE_BEGIN("huge_page_allocator");
+
+static_assert(std::is_same_v<xmem::allocator_rebind<xmem::huge_page_allocator<char>>::to<int>, xmem::huge_page_allocator<int>>);
+
+TEST_CASE("huge_page_allocator") {
+    obj::lifetime_stats stats;
+    xmem::huge_page_allocator<char> a;
+
+    {
+        std::vector<xmem::shared_ptr<obj>> objs;
+        for (int i = 0; i < 10000; ++i) {
+            objs.push_back(xmem::allocate_shared<obj>(a, i));
+        }
+        auto hs = xmem::get_huge_page_stats();
+        CHECK(hs.regions >= 1);
+        CHECK(hs.hugetlb_regions <= hs.regions);
+
+        // small blocks share regions
+        constexpr uintptr_t region_mask = ~uintptr_t(2 * 1024 * 1024 - 1);
+        size_t same_region = 0;
+        for (size_t i = 1; i < objs.size(); ++i) {
+            auto r0 = reinterpret_cast<uintptr_t>(objs[i - 1].t_owner()) & region_mask;
+            auto r1 = reinterpret_cast<uintptr_t>(objs[i].t_owner()) & region_mask;
+            if (r0 == r1) ++same_region;
+        }
+        CHECK(same_region > objs.size() / 2);
+
+        for (size_t i = 0; i < objs.size(); ++i) {
+            CHECK(objs[i]->a == int(i));
+        }
+        CHECK(stats.living == 10000);
+
+        // not pooled
+        auto big = xmem::allocate_shared<int[]>(a, 1000, 5);
+        CHECK(big[999] == 5);
+    }
+    CHECK(stats.living == 0);
+
+    // the pools are separate from the ones of pool_allocator
+    // a freed huge page block would be the next one a shared pool serves
+    auto h = a.allocate(16);
+    a.deallocate(h, 16);
+    auto regions = xmem::get_huge_page_stats().regions;
+    xmem::pool_allocator<char> pa;
+    auto p = pa.allocate(16);
+    CHECK(p != h);
+    CHECK(a.allocate(16) == h);
+    a.deallocate(h, 16);
+    pa.deallocate(p, 16);
+    CHECK(xmem::get_huge_page_stats().regions == regions);
+}
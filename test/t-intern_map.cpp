@@ -0,0 +1,145 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/intern_map.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("intern_map");
+
+TEST_CASE("basic") {
+    obj::lifetime_stats stats;
+    xmem::intern_map<std::string, obj> map;
+    int created = 0;
+    auto factory = [&](int a) {
+        return [&created, a]() {
+            ++created;
+            return xmem::make_expiry_shared<obj>(a);
+        };
+    };
+
+    auto a = map.get_or_create("a", factory(1));
+    auto a2 = map.get_or_create("a", factory(2));
+    CHECK(a == a2);
+    CHECK(a->a == 1);
+    CHECK(created == 1);
+
+    auto b = map.get_or_create("b", factory(2));
+    CHECK(b->a == 2);
+    CHECK(map.size() == 2);
+    CHECK(map.find("a") == a);
+    CHECK_FALSE(map.find("c"));
+
+    // the entry is removed when the value dies
+    b.reset();
+    CHECK(map.size() == 1);
+    CHECK_FALSE(map.find("b"));
+    b = map.get_or_create("b", factory(3));
+    CHECK(b->a == 3);
+    CHECK(created == 3);
+
+    // null values are not added
+    auto n = map.get_or_create("n", []() { return xmem::expiry_shared_ptr<obj>{}; });
+    CHECK_FALSE(n);
+    CHECK(map.size() == 2);
+
+    a.reset();
+    a2.reset();
+    b.reset();
+    CHECK(map.size() == 0);
+    CHECK(stats.living == 0);
+
+    // values may outlive the map
+    {
+        xmem::intern_map<int, int> imap(1);
+        CHECK(imap.num_shards() == 1);
+        n.reset();
+        auto i = imap.get_or_create(5, []() { return xmem::make_expiry_shared<int>(5); });
+        auto i2 = imap.get_or_create(5, []() { return xmem::make_expiry_shared<int>(6); });
+        CHECK(i == i2);
+        a = xmem::make_expiry_shared<obj>(*i);
+    }
+    CHECK(a->a == 5);
+}
+
+TEST_CASE("recursive factory") {
+    // the factory can intern other values
+    xmem::intern_map<int, std::vector<xmem::expiry_shared_ptr<int>>> map(4);
+    xmem::intern_map<int, int> ints(4);
+    auto v = map.get_or_create(3, [&]() {
+        auto ret = xmem::make_expiry_shared<std::vector<xmem::expiry_shared_ptr<int>>>();
+        for (int i = 0; i < 3; ++i) {
+            ret->push_back(ints.get_or_create(i, [i]() { return xmem::make_expiry_shared<int>(i); }));
+        }
+        return ret;
+    });
+    CHECK(v->size() == 3);
+    CHECK(ints.size() == 3);
+    CHECK(ints.find(1) == (*v)[1]);
+    v.reset();
+    CHECK(map.size() == 0);
+    CHECK(ints.size() == 0);
+}
+
+namespace {
+struct reviver {
+    xmem::intern_map<int, reviver>* map;
+    xmem::expiry_shared_ptr<reviver>* revived;
+    reviver(xmem::intern_map<int, reviver>* m, xmem::expiry_shared_ptr<reviver>* r) : map(m), revived(r) {}
+    ~reviver() {
+        if (!revived) return;
+        // the entry of this is expired, but not removed yet
+        *revived = map->get_or_create(1, [this]() { return xmem::make_expiry_shared<reviver>(map, nullptr); });
+    }
+};
+}
+
+TEST_CASE("replace expired entry") {
+    xmem::intern_map<int, reviver> map;
+    xmem::expiry_shared_ptr<reviver> revived;
+    auto p = map.get_or_create(1, [&]() { return xmem::make_expiry_shared<reviver>(&map, &revived); });
+    p.reset();
+    REQUIRE(revived);
+    CHECK_FALSE(revived->revived);
+    CHECK(map.size() == 1);
+    CHECK(map.find(1) == revived);
+    revived.reset();
+    CHECK(map.size() == 0);
+}
+
+TEST_CASE("threads") {
+    xmem::intern_map<int, int> map(8);
+    std::atomic_int created = {0};
+    constexpr int num_keys = 64;
+
+    auto proc = [&](int seed) {
+        std::vector<xmem::expiry_shared_ptr<int>> held(num_keys);
+        for (int i = 0; i < 20000; ++i) {
+            int key = (i * 7 + seed) % num_keys;
+            auto p = map.get_or_create(key, [&]() {
+                ++created;
+                return xmem::make_expiry_shared<int>(key);
+            });
+            CHECK(*p == key);
+            // keep some, drop others, so values keep dying and getting recreated
+            if ((i + seed) % 3) held[key] = std::move(p);
+            else held[(key + 1) % num_keys].reset();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back(proc, i);
+    }
+    for (auto& t : threads) t.join();
+
+    CHECK(map.size() == 0);
+    CHECK(created > num_keys);
+}
@@ -0,0 +1,107 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#define XMEM_ITERATIVE_DESTRUCTION 1
+#include <doctest/doctest.h>
+
+#include <xmem/shared_ptr.hpp>
+#include <xmem/local_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <vector>
+
+TEST_SUITE_BEGIN("iterative destruction");
+
+namespace {
+template <template <typename> class Ptr>
+struct node {
+    Ptr<node> next;
+    int* destroyed;
+    explicit node(int& d, Ptr<node> n = {}) : next(std::move(n)), destroyed(&d) {}
+    ~node() { ++*destroyed; }
+};
+
+struct tree {
+    xmem::shared_ptr<tree> left, right;
+    xmem::weak_ptr<tree> parent;
+    int* destroyed;
+    explicit tree(int& d) : destroyed(&d) {}
+    ~tree() { ++*destroyed; }
+};
+
+void grow(const xmem::shared_ptr<tree>& t, int depth, int& d) {
+    if (!depth) return;
+    t->left = xmem::make_shared<tree>(d);
+    t->left->parent = t;
+    t->right = xmem::make_shared<tree>(d);
+    t->right->parent = t;
+    grow(t->left, depth - 1, d);
+    grow(t->right, depth - 1, d);
+}
+}
+
+TEST_CASE("long list") {
+    // deep enough to overflow the stack if destroyed recursively
+    constexpr int n = 1'000'000;
+
+    int destroyed = 0;
+    {
+        using lnode = node<xmem::shared_ptr>;
+        xmem::shared_ptr<lnode> head;
+        for (int i = 0; i < n; ++i) {
+            head = xmem::make_shared<lnode>(destroyed, std::move(head));
+        }
+        xmem::weak_ptr<lnode> w = head->next;
+        head.reset();
+        CHECK(destroyed == n);
+        CHECK(w.expired());
+    }
+    CHECK(destroyed == n);
+
+    destroyed = 0;
+    {
+        using lnode = node<xmem::local_shared_ptr>;
+        xmem::local_shared_ptr<lnode> head;
+        for (int i = 0; i < n; ++i) {
+            head = xmem::make_local_shared<lnode>(destroyed, std::move(head));
+        }
+        auto mid = head;
+        for (int i = 0; i < n / 2; ++i) mid = mid->next;
+        head.reset();
+        CHECK(destroyed == n / 2);
+        mid.reset();
+        CHECK(destroyed == n);
+    }
+}
+
+TEST_CASE("tree") {
+    int destroyed = 0;
+    {
+        auto root = xmem::make_shared<tree>(destroyed);
+        grow(root, 10, destroyed);
+        auto leaf = root->left->right->left;
+        root.reset();
+        CHECK(destroyed == (1 << 11) - (1 << 8)); // the leaf keeps its subtree
+        CHECK(leaf->parent.expired());
+    }
+    CHECK(destroyed == (1 << 11) - 1);
+}
+
+TEST_CASE("nested releases in destructors") {
+    obj::lifetime_stats stats;
+    struct holder {
+        std::vector<xmem::shared_ptr<obj>> objs;
+    };
+    {
+        auto h = xmem::make_shared<holder>();
+        for (int i = 0; i < 10; ++i) {
+            h->objs.push_back(xmem::make_shared<obj>(i));
+        }
+        auto keep = h->objs[3];
+        h.reset();
+        CHECK(stats.living == 1);
+        CHECK(keep->a == 3);
+    }
+    CHECK(stats.living == 0);
+}
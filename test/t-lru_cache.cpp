@@ -0,0 +1,186 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/lru_cache.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("lru_cache");
+
+TEST_CASE("clock") {
+    obj::lifetime_stats stats;
+    xmem::lru_cache<int, obj> cache(3, 1);
+    CHECK(cache.num_shards() == 1);
+    CHECK(cache.capacity() == 3);
+
+    for (int i = 0; i < 3; ++i) {
+        CHECK(cache.insert(i, xmem::make_shared<obj>(i)));
+    }
+    CHECK(cache.size() == 3);
+    CHECK(stats.living == 3);
+
+    CHECK(cache.get(0)->a == 0); // marked
+    CHECK(cache.insert(3, xmem::make_shared<obj>(3)));
+    CHECK(cache.size() == 3);
+    CHECK(stats.living == 3);
+    CHECK_FALSE(cache.get(1)); // evicted and dead
+    CHECK(cache.get(0));
+    CHECK(cache.get(2));
+    CHECK(cache.get(3));
+
+    CHECK_FALSE(cache.get(10));
+}
+
+TEST_CASE("capacity split") {
+    obj::lifetime_stats stats;
+    xmem::lru_cache<int, obj> cache(70, 4); // 18 + 18 + 17 + 17
+    CHECK(cache.num_shards() == 4);
+    for (int i = 0; i < 1000; ++i) {
+        cache.insert(i, xmem::make_shared<obj>(i));
+        CHECK(cache.cost() <= 70);
+    }
+    CHECK(cache.size() == 70);
+    CHECK(stats.living == 70);
+}
+
+TEST_CASE("small capacity") {
+    // the default number of shards is clamped, so no shard is left without capacity
+    xmem::lru_cache<int, int> small(8);
+    CHECK(small.num_shards() == 1);
+    int admitted = 0;
+    for (int i = 0; i < 64; ++i) {
+        admitted += small.insert(i, xmem::make_shared<int>(i));
+    }
+    CHECK(admitted == 64);
+    CHECK(small.size() == 8);
+
+    xmem::lru_cache<int, int> mid(100);
+    CHECK(mid.num_shards() == 4);
+    CHECK(mid.insert(0, xmem::make_shared<int>(0), 25)); // fits in a shard
+
+    xmem::lru_cache<int, int> large(10'000);
+    CHECK(large.num_shards() == 16);
+}
+
+TEST_CASE("pins and weak fallback") {
+    obj::lifetime_stats stats;
+    xmem::lru_cache<std::string, obj> cache(2, 1);
+    auto a = xmem::make_shared<obj>(1);
+    cache.insert("a", a);
+    cache.insert("b", xmem::make_shared<obj>(2));
+
+    // a is pinned, so b is evicted
+    cache.insert("c", xmem::make_shared<obj>(3));
+    CHECK(cache.size() == 2);
+    CHECK(stats.living == 2);
+    CHECK_FALSE(cache.get("b"));
+
+    // all pinned: a is evicted eventually, but stays reachable
+    auto c = cache.get("c");
+    cache.insert("d", xmem::make_shared<obj>(4));
+    auto d = cache.get("d");
+    cache.insert("e", xmem::make_shared<obj>(5));
+    CHECK(cache.size() == 2);
+    CHECK(stats.living == 4);
+
+    // evicted values which are alive are readmitted
+    CHECK(cache.get("a") == a);
+    CHECK(cache.get("c") == c);
+    CHECK(cache.get("d") == d);
+    CHECK(cache.size() == 2);
+
+    a.reset();
+    c.reset();
+    d.reset();
+    cache.clear();
+    CHECK(cache.size() == 0);
+    CHECK(stats.living == 0);
+}
+
+TEST_CASE("cost") {
+    xmem::lru_cache<int, std::vector<char>> cache(100, 1);
+    auto insert = [&](int key, size_t size) {
+        auto v = xmem::make_shared<std::vector<char>>(size);
+        return cache.insert(key, std::move(v), size);
+    };
+    CHECK(insert(1, 40));
+    CHECK(insert(2, 40));
+    CHECK(cache.cost() == 80);
+    CHECK(insert(3, 40));
+    CHECK(cache.cost() == 80);
+    CHECK(cache.size() == 2);
+    CHECK_FALSE(cache.get(1));
+
+    // replace
+    CHECK(insert(2, 10));
+    CHECK(cache.cost() == 50);
+    CHECK(cache.get(2)->size() == 10);
+
+    // too big
+    auto big = xmem::make_shared<std::vector<char>>(200);
+    CHECK_FALSE(cache.insert(4, big, 200));
+    CHECK(cache.cost() == 50);
+    CHECK(cache.get(4) == big);
+    big.reset();
+    CHECK_FALSE(cache.get(4));
+
+    CHECK(cache.erase(2));
+    CHECK_FALSE(cache.erase(2));
+    CHECK(cache.cost() == 40);
+    CHECK_FALSE(cache.insert(5, nullptr));
+}
+
+TEST_CASE("sweep") {
+    obj::lifetime_stats stats;
+    xmem::lru_cache<int, obj> cache(10, 1);
+    std::vector<xmem::shared_ptr<obj>> held;
+    for (int i = 0; i < 10000; ++i) {
+        auto p = xmem::make_shared<obj>(i);
+        if (i % 100 == 0) held.push_back(p);
+        cache.insert(i, std::move(p));
+    }
+    CHECK(cache.size() == 10);
+    CHECK(stats.living >= 100);
+    CHECK(stats.living <= 110);
+    for (auto& h : held) {
+        CHECK(cache.get(h->a) == h);
+    }
+}
+
+TEST_CASE("threads") {
+    obj::lifetime_stats stats;
+    {
+        xmem::lru_cache<int, obj> cache(64, 4);
+        auto proc = [&](unsigned seed) {
+            std::minstd_rand rnd(seed);
+            xmem::shared_ptr<obj> held;
+            for (int i = 0; i < 20000; ++i) {
+                int key = int(rnd() % 256);
+                auto p = cache.get(key);
+                if (!p) {
+                    p = xmem::make_shared<obj>(key);
+                    cache.insert(key, p);
+                }
+                CHECK(p->a == key);
+                if (rnd() % 8 == 0) held = p;
+                if (rnd() % 64 == 0) cache.erase(key);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < 4; ++i) {
+            threads.emplace_back(proc, i + 1);
+        }
+        for (auto& t : threads) t.join();
+        CHECK(cache.size() <= 64);
+        CHECK(cache.cost() == cache.size());
+    }
+    CHECK(stats.living == 0);
+}
@@ -0,0 +1,89 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/make_shared_batch.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <stdexcept>
+
+TEST_SUITE_BEGIN("make_shared_batch");
+
+TEST_CASE("batch") {
+    obj::lifetime_stats stats;
+
+    CHECK(xmem::make_shared_batch<obj>(0).empty());
+
+    xmem::weak_ptr<obj> w;
+    {
+        auto batch = xmem::make_shared_batch<obj>(5, 3, "three");
+        REQUIRE(batch.size() == 5);
+        CHECK(stats.living == 5);
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            CHECK(batch[i]->a == 3);
+            CHECK(batch[i]->b == "three");
+            CHECK(batch[i].get() == batch[0].get() + i);
+            CHECK(xmem::same_owner(batch[i], batch[0]));
+        }
+        CHECK(batch[0].use_count() == 5);
+
+        w = batch[3];
+        auto keep = batch[3];
+        batch.clear();
+
+        // a single element keeps all alive
+        CHECK(stats.living == 5);
+        CHECK(keep->a == 3);
+        CHECK(keep.use_count() == 1);
+    }
+    CHECK(w.expired());
+    CHECK(stats.living == 0);
+
+    auto lbatch = xmem::make_local_shared_batch<avx_512>(3);
+    for (auto& p : lbatch) {
+        CHECK(reinterpret_cast<uintptr_t>(p.get()) % 64 == 0);
+    }
+}
+
+namespace {
+int num_allocs = 0;
+
+template <typename T>
+struct counting_allocator : public xmem::allocator<T> {
+    counting_allocator() noexcept = default;
+    template <typename U>
+    counting_allocator(const counting_allocator<U>&) noexcept {}
+    T* allocate(size_t n) {
+        ++num_allocs;
+        return xmem::allocator<T>::allocate(n);
+    }
+};
+
+struct thrower : public doctest::util::lifetime_counter<thrower> {
+    static inline int countdown = 0;
+    thrower() {
+        if (--countdown == 0) throw std::runtime_error("thrower");
+    }
+};
+}
+
+TEST_CASE("array resource") {
+    using factory = xmem::atomic_control_block_factory;
+
+    {
+        auto pair = factory::make_array_resource_cb<int>(counting_allocator<char>{}, 100, 42);
+        CHECK(num_allocs == 1);
+        xmem::shared_ptr<int> p(std::move(pair));
+        CHECK(p.get()[0] == 42);
+        CHECK(p.get()[99] == 42);
+    }
+
+    thrower::lifetime_stats stats;
+    thrower::countdown = 4;
+    CHECK_THROWS_AS((void)xmem::make_shared_batch<thrower>(10), std::runtime_error);
+    CHECK(stats.total == 4); // the counter of the throwing one is also constructed
+    CHECK(stats.living == 0);
+}
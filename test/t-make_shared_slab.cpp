@@ -0,0 +1,118 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/make_shared_slab.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+
+TEST_SUITE_BEGIN("make_shared_slab");
+
+namespace {
+int num_allocs = 0;
+int num_deallocs = 0;
+
+template <typename T>
+struct counting_allocator : public xmem::allocator<T> {
+    counting_allocator() noexcept = default;
+    template <typename U>
+    counting_allocator(const counting_allocator<U>&) noexcept {}
+    T* allocate(size_t n) {
+        ++num_allocs;
+        return xmem::allocator<T>::allocate(n);
+    }
+    void deallocate(T* p, size_t n) {
+        ++num_deallocs;
+        xmem::allocator<T>::deallocate(p, n);
+    }
+};
+}
+
+TEST_CASE("slab") {
+    obj::lifetime_stats stats;
+
+    CHECK(xmem::make_shared_slab<obj>(0).empty());
+
+    auto slab = xmem::make_shared_slab<obj>(4, 7);
+    REQUIRE(slab.size() == 4);
+    CHECK(stats.living == 4);
+
+    for (auto& p : slab) {
+        CHECK(p->a == 7);
+        CHECK(p.use_count() == 1);
+    }
+    CHECK_FALSE(xmem::same_owner(slab[0], slab[1]));
+
+    xmem::weak_ptr<obj> w = slab[2];
+    auto copy = slab[1];
+
+    // independent lifetimes
+    slab[2].reset();
+    CHECK(w.expired());
+    CHECK(stats.living == 3);
+
+    slab.clear();
+    CHECK(stats.living == 1);
+    CHECK(copy->a == 7);
+    CHECK(copy.use_count() == 1);
+
+    copy.reset();
+    CHECK(stats.living == 0);
+
+    // the weak pointer keeps the slab alive
+    w.reset();
+
+    auto local = xmem::make_local_shared_slab<avx_512>(3);
+    for (auto& p : local) {
+        CHECK(reinterpret_cast<uintptr_t>(p.get()) % 64 == 0);
+    }
+}
+
+TEST_CASE("slab single allocation") {
+    using factory = xmem::local_control_block_factory;
+
+    std::vector<xmem::local_shared_ptr<int>> ptrs;
+    factory::make_slab_resource_cbs<int>(counting_allocator<char>{}, 10, [&](auto&& pair) {
+        ptrs.emplace_back(std::move(pair));
+    }, 5);
+    CHECK(num_allocs == 1);
+    CHECK(ptrs.size() == 10);
+    CHECK(*ptrs[9] == 5);
+
+    for (size_t i = 0; i < 9; ++i) {
+        ptrs[i].reset();
+    }
+    CHECK(num_deallocs == 0);
+    ptrs.clear();
+    CHECK(num_deallocs == 1);
+}
+
+namespace {
+struct thrower : public doctest::util::lifetime_counter<thrower> {
+    static inline int countdown = 0;
+    thrower() {
+        if (--countdown == 0) throw std::runtime_error("thrower");
+    }
+};
+}
+
+TEST_CASE("slab throw") {
+    thrower::lifetime_stats stats;
+    thrower::countdown = 3;
+    CHECK_THROWS_AS((void)xmem::make_shared_slab<thrower>(10), std::runtime_error);
+    CHECK(stats.living == 0);
+}
+
+TEST_CASE("slab size overflow") {
+    obj::lifetime_stats stats;
+    // a slot is larger than its object, so the size of the allocation overflows
+    constexpr size_t huge = SIZE_MAX / sizeof(obj) + 1;
+    int pairs = 0;
+    CHECK_THROWS_AS(xmem::atomic_control_block_factory::make_slab_resource_cbs<obj>(xmem::allocator<char>{}, huge, [&](auto&&) { ++pairs; }), std::bad_array_new_length);
+    CHECK(pairs == 0);
+    CHECK(stats.total == 0);
+}
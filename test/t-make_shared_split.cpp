@@ -0,0 +1,151 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/shared_ptr.hpp>
+#include <xmem/local_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <stdexcept>
+
+TEST_SUITE_BEGIN("make_shared_split");
+
+namespace {
+struct alloc_stats {
+    int allocs = 0;
+    int deallocs = 0;
+    size_t live_bytes = 0;
+};
+
+template <typename T>
+struct stats_allocator {
+    using value_type = T;
+
+    alloc_stats* stats;
+
+    explicit stats_allocator(alloc_stats& s) noexcept : stats(&s) {}
+    template <typename U>
+    stats_allocator(const stats_allocator<U>& other) noexcept : stats(other.stats) {}
+
+    T* allocate(size_t n) {
+        ++stats->allocs;
+        stats->live_bytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n) {
+        ++stats->deallocs;
+        stats->live_bytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+};
+
+struct big {
+    int a = 0;
+    char buf[XMEM_SPLIT_ALLOCATION_THRESHOLD];
+    big() = default;
+    explicit big(int a) : a(a) {}
+};
+
+struct big_unsplit {
+    char buf[XMEM_SPLIT_ALLOCATION_THRESHOLD];
+};
+
+struct throws {
+    throws() { throw std::runtime_error("nope"); }
+};
+}
+
+template <>
+struct xmem::split_allocation<big_unsplit> : std::false_type {};
+
+static_assert(xmem::split_allocation<big>::value);
+static_assert(!xmem::split_allocation<obj>::value);
+static_assert(!xmem::split_allocation<big_unsplit>::value);
+
+TEST_CASE("threshold") {
+    alloc_stats astats;
+    stats_allocator<char> a(astats);
+
+    {
+        auto p = xmem::allocate_shared<big>(a, 3);
+        CHECK(p->a == 3);
+        CHECK(astats.allocs == 2);
+        CHECK(astats.live_bytes > sizeof(big));
+
+        xmem::weak_ptr<big> w = p;
+        p.reset();
+        CHECK(w.expired());
+
+        // only the control block is left
+        CHECK(astats.deallocs == 1);
+        CHECK(astats.live_bytes < sizeof(big));
+    }
+    CHECK(astats.deallocs == 2);
+    CHECK(astats.live_bytes == 0);
+
+    {
+        auto p = xmem::allocate_local_shared_for_overwrite<big>(a);
+        CHECK(astats.allocs == 4);
+        xmem::local_weak_ptr<big> w = p;
+        p.reset();
+        CHECK(astats.deallocs == 3);
+    }
+    CHECK(astats.deallocs == 4);
+
+    {
+        auto p = xmem::allocate_shared<big_unsplit>(a);
+        CHECK(astats.allocs == 5);
+        xmem::weak_ptr<big_unsplit> w = p;
+        p.reset();
+        CHECK(astats.deallocs == 4); // pinned by the weak pointer
+    }
+    CHECK(astats.deallocs == 5);
+    CHECK(astats.live_bytes == 0);
+
+    auto p = xmem::make_shared<big>(5);
+    CHECK(p->a == 5);
+    auto lp = xmem::make_local_shared<big>();
+    CHECK(lp->a == 0);
+}
+
+TEST_CASE("explicit") {
+    obj::lifetime_stats ostats;
+
+    {
+        auto p = xmem::make_shared_split<obj>(1, "one");
+        CHECK(p->a == 1);
+        CHECK(p->b == "one");
+        CHECK(p.use_count() == 1);
+
+        xmem::weak_ptr<obj> w = p;
+        auto p2 = w.lock();
+        CHECK(p2 == p);
+        p.reset();
+        p2.reset();
+        CHECK(ostats.living == 0);
+        CHECK_FALSE(w.lock());
+
+        xmem::shared_ptr<const obj> cp = xmem::make_shared_split<child>(2, 3);
+        CHECK(cp->val() == 5);
+
+        auto lp = xmem::make_local_shared_split<obj>(4, "four");
+        CHECK(lp->b == "four");
+        CHECK(ostats.living == 2);
+    }
+    CHECK(ostats.living == 0);
+    CHECK(ostats.total == 3);
+}
+
+TEST_CASE("exceptions") {
+    alloc_stats astats;
+    stats_allocator<char> a(astats);
+
+    using factory = xmem::atomic_control_block_factory;
+    CHECK_THROWS_AS(factory::make_split_resource_cb<throws>(a), std::runtime_error);
+    CHECK(astats.allocs == 2);
+    CHECK(astats.deallocs == 2);
+
+    CHECK_THROWS_AS(xmem::make_local_shared_split<throws>(), std::runtime_error);
+}
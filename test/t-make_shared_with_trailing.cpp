@@ -0,0 +1,101 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/shared_ptr.hpp>
+#include <xmem/local_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+TEST_SUITE_BEGIN("make_shared_with_trailing");
+
+namespace {
+struct record {
+    int id;
+    xmem::trailing_span<char> bytes;
+    record(xmem::trailing_span<char> tail, int id, const char* str) : id(id), bytes(tail) {
+        memcpy(bytes.data(), str, bytes.size());
+    }
+    std::string str() const { return std::string(bytes.data(), bytes.size()); }
+};
+
+struct node : public doctest::util::lifetime_counter<node> {
+    xmem::trailing_span<obj> children;
+    explicit node(xmem::trailing_span<obj> c) : children(c) {}
+};
+}
+
+TEST_CASE("trailing") {
+    auto r = xmem::make_shared_with_trailing<record, char>(5, 42, "hello");
+    CHECK(r->id == 42);
+    CHECK(r->str() == "hello");
+    CHECK(reinterpret_cast<char*>(r->bytes.data()) >= reinterpret_cast<char*>(r.get() + 1));
+
+    auto e = xmem::make_shared_with_trailing<record, char>(0, 1, "");
+    CHECK(e->bytes.empty());
+    CHECK(e->str().empty());
+
+    obj::lifetime_stats ostats;
+    node::lifetime_stats nstats;
+    {
+        xmem::local_weak_ptr<node> w;
+        {
+            auto n = xmem::make_local_shared_with_trailing<node, obj>(3);
+            w = n;
+            CHECK(n->children.size() == 3);
+            for (auto& c : n->children) {
+                CHECK(c.a == 11);
+            }
+            CHECK(ostats.living == 3);
+            CHECK(nstats.living == 1);
+        }
+        CHECK(w.expired());
+        CHECK(ostats.living == 0);
+        CHECK(nstats.living == 0);
+    }
+}
+
+namespace {
+int num_allocs = 0;
+
+template <typename T>
+struct counting_allocator : public xmem::allocator<T> {
+    counting_allocator() noexcept = default;
+    template <typename U>
+    counting_allocator(const counting_allocator<U>&) noexcept {}
+    T* allocate(size_t n) {
+        ++num_allocs;
+        return xmem::allocator<T>::allocate(n);
+    }
+};
+
+struct thrower {
+    thrower(xmem::trailing_span<obj>) { throw std::runtime_error("thrower"); }
+};
+}
+
+TEST_CASE("trailing resource") {
+    using factory = xmem::atomic_control_block_factory;
+    {
+        xmem::shared_ptr<record> r(factory::make_trailing_resource_cb<record, char>(counting_allocator<char>{}, 3, 1, "abc"));
+        CHECK(num_allocs == 1);
+        CHECK(r->str() == "abc");
+    }
+
+    obj::lifetime_stats stats;
+    CHECK_THROWS_AS((void)(xmem::make_shared_with_trailing<thrower, obj>(4)), std::runtime_error);
+    CHECK(stats.total == 4);
+    CHECK(stats.living == 0);
+
+    // the size of the allocation overflows
+    constexpr size_t huge = SIZE_MAX / sizeof(obj) + 1;
+    CHECK_THROWS_AS((void)(xmem::make_shared_with_trailing<node, obj>(huge)), std::bad_array_new_length);
+    CHECK_THROWS_AS((void)(xmem::make_local_shared_with_trailing<node, obj>(huge)), std::bad_array_new_length);
+    CHECK(stats.total == 4);
+}
@@ -0,0 +1,72 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/numa.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <thread>
+
+TEST_SUITE_BEGIN("numa");
+
+TEST_CASE("simulated topology") {
+    obj::lifetime_stats stats;
+    xmem::simulated_numa_topology topo(2);
+    xmem::numa_pools pools(topo);
+
+    xmem::simulated_numa_topology::set_current_node(1);
+    CHECK(topo.current_node() == 1);
+
+    auto p = xmem::allocate_shared<obj>(xmem::numa_allocator<char>(pools), 5);
+    CHECK(topo.node_of(p.get()) == 1);
+    CHECK(topo.node_of(p.t_owner()) == 1);
+
+    auto q = xmem::allocate_shared<obj>(xmem::numa_allocator<char>(pools, 0), 6);
+    CHECK(topo.node_of(q.get()) == 0);
+
+    auto a = xmem::allocate_shared<avx_512>(xmem::numa_allocator<char>(pools, 0));
+    CHECK(topo.node_of(a.get()) == 0);
+    CHECK(reinterpret_cast<uintptr_t>(a.get()) % 64 == 0);
+
+    auto big = xmem::allocate_shared<int[]>(xmem::numa_allocator<char>(pools, 1), 100000, 3);
+    CHECK(topo.node_of(big.get()) == 1);
+    CHECK(big[99999] == 3);
+
+    // created by a thread on node 0
+    xmem::shared_ptr<obj> t;
+    std::thread([&]() {
+        xmem::simulated_numa_topology::set_current_node(0);
+        t = xmem::allocate_shared<obj>(xmem::numa_allocator<char>(pools), 7);
+    }).join();
+    CHECK(topo.node_of(t.get()) == 0);
+
+    // freed in another thread, the memory returns to the pool of its node
+    auto pcb = p.t_owner();
+    std::thread([p = std::move(p)]() mutable {
+        xmem::simulated_numa_topology::set_current_node(0);
+        p.reset();
+    }).join();
+    auto p2 = xmem::allocate_shared<obj>(xmem::numa_allocator<char>(pools, 1), 8);
+    CHECK(p2.t_owner() == pcb);
+
+    q.reset();
+    a.reset();
+    big.reset();
+    t.reset();
+    p2.reset();
+    CHECK(stats.living == 0);
+    xmem::simulated_numa_topology::set_current_node(0);
+}
+
+TEST_CASE("system topology") {
+    auto& topo = xmem::numa_topology::system();
+    CHECK(topo.num_nodes() >= 1);
+    CHECK(topo.current_node() < topo.num_nodes());
+
+    auto p = xmem::make_numa_shared<obj>(1, "one");
+    CHECK(p->b == "one");
+    auto q = xmem::make_numa_shared_on<obj>(topo.num_nodes() - 1, 2);
+    CHECK(q->a == 2);
+}
@@ -0,0 +1,152 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/object_pool.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("object_pool");
+
+namespace {
+struct message {
+    int id;
+    std::vector<int> buf;
+    explicit message(int id) : id(id) {
+        buf.reserve(1000);
+    }
+};
+
+struct clear_message {
+    int* resets;
+    void operator()(message& m) const noexcept {
+        m.buf.clear();
+        ++*resets;
+    }
+};
+}
+
+TEST_CASE("recycle") {
+    obj::lifetime_stats ostats;
+    {
+        xmem::object_pool<obj> pool;
+        auto a = pool.acquire(1, "one");
+        CHECK(a->a == 1);
+        CHECK(a.use_count() == 1);
+        auto pa = a.get();
+        a.reset();
+        CHECK(ostats.living == 1); // recycled, not destroyed
+
+        auto b = pool.acquire(2, "two");
+        CHECK(b.get() == pa);
+        CHECK(b->a == 1); // warm object as it was
+        CHECK(pool.created() == 1);
+
+        auto c = pool.acquire(3);
+        CHECK(c.get() != pa);
+        CHECK(c->a == 3);
+        CHECK(pool.created() == 2);
+
+        xmem::weak_ptr<obj> wc = c;
+        CHECK(wc.lock() == c);
+        c.reset();
+        CHECK(wc.expired());
+        CHECK_FALSE(wc.lock());
+
+        // still referenced by a weak pointer, so not available
+        auto d = pool.acquire(4);
+        CHECK(d->a == 4);
+        CHECK(pool.created() == 3);
+
+        wc.reset();
+        auto e = pool.acquire(5);
+        CHECK(e->a == 3);
+        CHECK(pool.created() == 3);
+
+        xmem::shared_ptr<obj> copy = e;
+        e.reset();
+        CHECK(copy->a == 3);
+        CHECK(ostats.living == 3);
+    }
+    CHECK(ostats.living == 0);
+    CHECK(ostats.total == 3);
+}
+
+TEST_CASE("reset hook") {
+    int resets = 0;
+    xmem::local_object_pool<message, clear_message> pool(clear_message{&resets});
+
+    auto m = pool.acquire(1);
+    m->buf.push_back(5);
+    auto data = m->buf.data();
+    m.reset();
+    CHECK(resets == 1);
+
+    m = pool.acquire(2);
+    CHECK(m->id == 1);
+    CHECK(m->buf.empty());
+    CHECK(m->buf.capacity() >= 1000);
+    CHECK(m->buf.data() == data);
+
+    std::vector<xmem::local_shared_ptr<message>> many;
+    for (int i = 0; i < 500; ++i) {
+        many.push_back(pool.acquire(i));
+    }
+    CHECK(pool.created() == 501);
+    many.clear();
+    m.reset();
+    CHECK(resets == 502);
+
+    for (int i = 0; i < 501; ++i) {
+        many.push_back(pool.acquire(i));
+    }
+    CHECK(pool.created() == 501);
+}
+
+TEST_CASE("throwing constructor") {
+    struct picky {
+        int id;
+        explicit picky(int i) : id(i) {
+            if (i < 0) throw std::invalid_argument("negative");
+        }
+    };
+
+    xmem::local_object_pool<picky> pool;
+    auto a = pool.acquire(1);
+    CHECK_THROWS_AS((void)pool.acquire(-1), std::invalid_argument);
+    CHECK(pool.created() == 1);
+
+    // the node of the failed acquire is reused: the objects are adjacent
+    auto b = pool.acquire(2);
+    auto c = pool.acquire(3);
+    CHECK(pool.created() == 3);
+    auto addr = [](const picky& p) { return reinterpret_cast<uintptr_t>(&p); };
+    CHECK(addr(*b) - addr(*a) == addr(*c) - addr(*b));
+}
+
+TEST_CASE("threads") {
+    xmem::object_pool<message> pool;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            std::vector<xmem::shared_ptr<message>> held;
+            for (int i = 0; i < 10000; ++i) {
+                auto m = pool.acquire(t);
+                m->id = t;
+                m->buf.push_back(i);
+                held.push_back(std::move(m));
+                if (held.size() == 8) {
+                    for (auto& h : held) CHECK(h->id == t);
+                    held.clear();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    CHECK(pool.created() <= 4 * 9);
+}
@@ -0,0 +1,120 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/parallel_release.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+TEST_SUITE_BEGIN("parallel_release");
+
+namespace {
+struct stats {
+    std::atomic_int destroyed = {0};
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+};
+
+struct node {
+    stats* s;
+    std::vector<xmem::teardown_shared_ptr<node>> children;
+    explicit node(stats& st) : s(&st) {}
+    ~node() {
+        ++s->destroyed;
+        std::lock_guard<std::mutex> _l(s->mutex);
+        s->threads.insert(std::this_thread::get_id());
+    }
+};
+
+// a random tree, returning the root
+xmem::teardown_shared_ptr<node> make_tree(stats& s, int n) {
+    std::minstd_rand rnd(42);
+    std::vector<xmem::teardown_shared_ptr<node>> nodes;
+    for (int i = 0; i < n; ++i) {
+        nodes.push_back(xmem::make_teardown_shared<node>(s));
+        if (i) nodes[rnd() % i]->children.push_back(nodes.back());
+    }
+    return nodes.front();
+}
+
+int subtree_size(const node& n) {
+    int ret = 1;
+    for (auto& c : n.children) ret += subtree_size(*c);
+    return ret;
+}
+}
+
+TEST_CASE("single thread") {
+    xmem::release_pool pool(1);
+    CHECK(pool.num_threads() == 1);
+
+    stats s;
+    std::vector<xmem::teardown_shared_ptr<node>> roots;
+    roots.push_back(make_tree(s, 1000));
+
+    // a long list is destroyed without recursion
+    auto head = xmem::make_teardown_shared<node>(s);
+    auto tail = head;
+    for (int i = 1; i < 200'000; ++i) {
+        tail->children.push_back(xmem::make_teardown_shared<node>(s));
+        tail = tail->children.back();
+    }
+    xmem::teardown_weak_ptr<node> wtail = tail;
+    tail.reset();
+    roots.push_back(std::move(head));
+
+    auto keep = roots.front()->children.front();
+    auto kept = subtree_size(*keep);
+
+    xmem::parallel_release(std::move(roots), pool);
+    CHECK(roots.empty());
+    CHECK(wtail.expired());
+    CHECK(s.destroyed == 201'000 - kept);
+    CHECK(s.threads.size() == 1);
+
+    keep.reset(); // regular release outside of a pool
+    CHECK(s.destroyed == 201'000);
+}
+
+TEST_CASE("threads") {
+    xmem::release_pool pool(4);
+
+    for (int round = 0; round < 3; ++round) {
+        stats s;
+        std::vector<xmem::teardown_shared_ptr<node>> roots;
+        for (int i = 0; i < 4; ++i) {
+            roots.push_back(make_tree(s, 20'000));
+        }
+        auto shared = roots[1]; // not a final release
+        xmem::parallel_release(std::move(roots), pool);
+        CHECK(s.destroyed == 60'000);
+        shared.reset();
+        CHECK(s.destroyed == 80'000);
+    }
+
+    // nothing to do
+    xmem::parallel_release(std::vector<xmem::teardown_shared_ptr<node>>{}, pool);
+}
+
+TEST_CASE("concurrent releases") {
+    xmem::release_pool pool(3);
+    stats s;
+    std::vector<std::thread> callers;
+    for (int i = 0; i < 4; ++i) {
+        callers.emplace_back([&]() {
+            for (int round = 0; round < 5; ++round) {
+                std::vector<xmem::teardown_shared_ptr<node>> roots;
+                roots.push_back(make_tree(s, 2'000));
+                pool.release(std::move(roots));
+            }
+        });
+    }
+    for (auto& t : callers) t.join();
+    CHECK(s.destroyed == 4 * 5 * 2'000);
+}
@@ -0,0 +1,103 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/pool_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <thread>
+#include <vector>
+#include <cstring>
+
+TEST_SUITE_BEGIN("pool_allocator");
+
+TEST_CASE("pool_allocator") {
+    xmem::pool_allocator<char> a;
+
+    auto p = a.allocate(40);
+    memset(p, 1, 40);
+    CHECK(reinterpret_cast<uintptr_t>(p) % 16 == 0);
+    a.deallocate(p, 40);
+    CHECK(a.allocate(33) == p); // same class, thread cache is lifo
+    a.deallocate(p, 33);
+
+    // many blocks of a class (more than a batch, so the cache has to exchange with the depot)
+    std::vector<char*> blocks;
+    for (int i = 0; i < 1000; ++i) {
+        blocks.push_back(a.allocate(100));
+        memset(blocks.back(), i & 0xff, 100);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(blocks[i][99] == char(i & 0xff));
+        a.deallocate(blocks[i], 100);
+    }
+
+    // not pooled
+    auto big = a.allocate(10000);
+    memset(big, 0, 10000);
+    a.deallocate(big, 10000);
+
+    xmem::pool_allocator<avx_512> aa = a;
+    auto ap = aa.allocate(1);
+    CHECK(reinterpret_cast<uintptr_t>(ap) % 64 == 0);
+    aa.deallocate(ap, 1);
+
+    CHECK(aa == a);
+}
+
+TEST_CASE("pool_allocator threads") {
+    // produce in one thread, consume in others
+    xmem::pool_allocator<uint64_t> a;
+    constexpr int num = 10000;
+    std::vector<uint64_t*> ptrs(num);
+
+    std::thread producer([&]() {
+        for (int i = 0; i < num; ++i) {
+            ptrs[i] = a.allocate(3);
+            ptrs[i][2] = i;
+        }
+    });
+    producer.join();
+
+    std::vector<std::thread> consumers;
+    for (int t = 0; t < 4; ++t) {
+        consumers.emplace_back([&, t]() {
+            for (int i = t; i < num; i += 4) {
+                if (ptrs[i][2] != uint64_t(i)) throw 0; // no doctest checks in threads
+                a.deallocate(ptrs[i], 3);
+            }
+            // and reuse some
+            for (int i = 0; i < 100; ++i) {
+                a.deallocate(a.allocate(3), 3);
+            }
+        });
+    }
+    for (auto& c : consumers) c.join();
+
+    // blocks freed by the consumers must get back to the depot
+    std::vector<uint64_t*> again;
+    for (int i = 0; i < num; ++i) {
+        again.push_back(a.allocate(3));
+    }
+    for (auto p : again) a.deallocate(p, 3);
+}
+
+TEST_CASE("make_pool_shared") {
+    obj::lifetime_stats stats;
+    {
+        auto p = xmem::make_pool_shared<child>(1, 2);
+        CHECK(p->val() == 3);
+        xmem::weak_ptr<obj> w = p;
+
+        std::thread([p = std::move(p)]() mutable {
+            p.reset(); // free in another thread
+        }).join();
+        CHECK(w.expired());
+
+        auto lp = xmem::make_local_pool_shared<obj>(5, "five");
+        CHECK(lp->b == "five");
+    }
+    CHECK(stats.living == 0);
+}
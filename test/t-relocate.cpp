@@ -0,0 +1,96 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/relocate.hpp>
+#include <xmem/shared_ptr.hpp>
+#include <xmem/local_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <memory>
+#include <string>
+
+TEST_SUITE_BEGIN("relocate");
+
+static_assert(xmem::is_trivially_relocatable_v<int>);
+static_assert(xmem::is_trivially_relocatable_v<vec>);
+static_assert(!xmem::is_trivially_relocatable_v<std::string>);
+static_assert(xmem::has_noop_transfer_v<xmem::atomic_control_block_factory::cb_type>);
+static_assert(xmem::is_trivially_relocatable_v<xmem::shared_ptr<obj>>);
+static_assert(xmem::is_trivially_relocatable_v<xmem::local_shared_ptr<int[]>>);
+static_assert(xmem::is_trivially_relocatable_v<xmem::weak_ptr<obj>>);
+static_assert(xmem::is_trivially_relocatable_v<xmem::unique_ptr<obj>>);
+static_assert(xmem::is_trivially_relocatable_v<xmem::unique_shareable_ptr<obj>>);
+static_assert(xmem::relocation_traits<xmem::unique_ptr<obj, void(*)(obj*)>>::bitwise);
+
+namespace {
+template <typename T>
+struct buffer {
+    alignas(T) unsigned char bytes[8 * sizeof(T)];
+    T* get() { return reinterpret_cast<T*>(bytes); }
+};
+}
+
+TEST_CASE("shared pointers") {
+    obj::lifetime_stats stats;
+    {
+        buffer<xmem::shared_ptr<obj>> a, b;
+        auto src = a.get();
+        for (int i = 0; i < 8; ++i) {
+            new (src + i) xmem::shared_ptr<obj>(xmem::make_shared<obj>(i));
+        }
+        xmem::weak_ptr<obj> w = src[3];
+
+        auto end = xmem::uninitialized_relocate(src, src + 8, b.get());
+        auto dst = b.get();
+        CHECK(end == dst + 8);
+        for (int i = 0; i < 8; ++i) {
+            CHECK(dst[i]->a == i);
+            CHECK(dst[i].use_count() == 1);
+        }
+        CHECK(w.lock() == dst[3]);
+        CHECK(stats.living == 8);
+
+        std::destroy(dst, dst + 8);
+        CHECK(w.expired());
+    }
+    CHECK(stats.living == 0);
+    CHECK(stats.total == 8);
+}
+
+TEST_CASE("unique pointers") {
+    obj::lifetime_stats stats;
+    {
+        buffer<xmem::unique_ptr<obj>> a, b;
+        auto src = a.get();
+        new (src) xmem::unique_ptr<obj>(new obj(1));
+        new (src + 1) xmem::unique_ptr<obj>();
+        xmem::uninitialized_relocate(src, src + 2, b.get());
+        auto dst = b.get();
+        CHECK(dst[0]->a == 1);
+        CHECK_FALSE(dst[1]);
+        std::destroy(dst, dst + 2);
+
+        buffer<xmem::unique_shareable_ptr<obj>> c, d;
+        auto usrc = new (c.get()) xmem::unique_shareable_ptr<obj>(xmem::make_unique_shareable<obj>(2));
+        xmem::uninitialized_relocate(usrc, usrc + 1, d.get());
+        xmem::shared_ptr<obj> s = std::move(*d.get());
+        CHECK(s->a == 2);
+        std::destroy_at(d.get());
+    }
+    CHECK(stats.living == 0);
+}
+
+TEST_CASE("non-trivial") {
+    buffer<std::string> a, b;
+    auto src = a.get();
+    new (src) std::string("a long string which isn't in the small buffer");
+    new (src + 1) std::string("x");
+    xmem::uninitialized_relocate(src, src + 2, b.get());
+    auto dst = b.get();
+    CHECK(dst[0] == "a long string which isn't in the small buffer");
+    CHECK(dst[1] == "x");
+    std::destroy(dst, dst + 2);
+}
@@ -7,6 +7,8 @@
 
 #include <xmem/local_ref_count.hpp>
 #include <xmem/common_control_block.hpp>
+#include <xmem/relocate.hpp>
+#include <xmem/weak_ptr_vector.hpp>
 
 #include <unordered_set>
 
@@ -20,6 +22,7 @@ struct bookkeeping_control_block : protected control_block_base<local_ref_count>
 
     std::unordered_set<const void*> active_strong;
     std::unordered_set<const void*> active_weak;
+    int num_batched_transfers = 0;
 
     ~bookkeeping_control_block() {
         CHECK(active_strong.empty());
@@ -69,12 +72,19 @@ struct bookkeeping_control_block : protected control_block_base<local_ref_count>
         return false;
     }
     using super::strong_ref_count;
+    using super::weak_ref_count;
 
     void transfer_strong(const void* dest, const void* src) {
         super::transfer_strong(dest, src);
         on_new_strong(dest);
         on_destroy_strong(src);
     }
+    void transfer_strong_n(const void* dest, const void* src, size_t n, size_t stride) {
+        ++num_batched_transfers;
+        for (size_t i = 0; i < n; ++i) {
+            transfer_strong(static_cast<const char*>(dest) + i * stride, static_cast<const char*>(src) + i * stride);
+        }
+    }
 
     void inc_weak_ref(const void* src) noexcept {
         super::inc_weak_ref(src);
@@ -89,6 +99,12 @@ struct bookkeeping_control_block : protected control_block_base<local_ref_count>
         on_new_weak(dest);
         on_destroy_weak(src);
     }
+    void transfer_weak_n(const void* dest, const void* src, size_t n, size_t stride) {
+        ++num_batched_transfers;
+        for (size_t i = 0; i < n; ++i) {
+            transfer_weak(static_cast<const char*>(dest) + i * stride, static_cast<const char*>(src) + i * stride);
+        }
+    }
 };
 
 using bookkeeping_control_block_factory = control_block_factory<bookkeeping_control_block>;
@@ -119,6 +135,11 @@ template <typename T>
     return bookkeeping_shared_ptr<T>(bookkeeping_control_block_factory::make_resource_cb_for_overwrite<T>(allocator<char>{}));
 }
 
+template <typename T>
+[[nodiscard]] bookkeeping_shared_ptr<T> make_bookkeeping_shared_for_overwrite(size_t n) {
+    return bookkeeping_shared_ptr<T>(bookkeeping_control_block_factory::make_resource_cb_for_overwrite<T>(allocator<char>{}, n));
+}
+
 }
 
 #define test_shared_ptr bookkeeping_shared_ptr
@@ -133,3 +154,96 @@ template <typename T>
 #define enable_test_shared_from_this enable_bookkeeping_shared_from_this
 
 #include <xmem/test-weak_ptr-shared_from-local.inl>
+
+TEST_CASE("bookkeeping unique shareable") {
+    using deleter = xmem::control_block_deleter<xmem::bookkeeping_control_block_factory>;
+    obj::lifetime_stats stats;
+    {
+        auto u = deleter::make_unique(xmem::bookkeeping_control_block_factory::make_resource_cb<obj>(xmem::allocator<char>{}, 1));
+        auto u2 = std::move(u);
+        xmem::unique_ptr<obj, deleter> u3;
+        u3 = std::move(u2);
+        xmem::bookkeeping_shared_ptr<obj> s = std::move(u3);
+        auto s2 = s;
+        CHECK_FALSE(s.unshare());
+        s2.reset();
+        auto u4 = s.unshare();
+        CHECK(u4);
+        u4.reset();
+        CHECK(stats.living == 0);
+    }
+}
+
+TEST_CASE("bookkeeping relocate") {
+    using sptr = xmem::bookkeeping_shared_ptr<obj>;
+    using wptr = xmem::bookkeeping_weak_ptr<obj>;
+    static_assert(!xmem::is_trivially_relocatable_v<sptr>);
+    static_assert(xmem::relocation_traits<sptr>::bitwise);
+
+    obj::lifetime_stats stats;
+    {
+        alignas(sptr) unsigned char sbuf[2][3 * sizeof(sptr)];
+        auto src = reinterpret_cast<sptr*>(sbuf[0]);
+        auto dst = reinterpret_cast<sptr*>(sbuf[1]);
+        auto p = xmem::make_bookkeeping_shared<obj>(1);
+        new (src) sptr(p);
+        new (src + 1) sptr();
+        new (src + 2) sptr(xmem::make_bookkeeping_shared<obj>(2));
+        xmem::uninitialized_relocate(src, src + 3, dst);
+        CHECK(dst[0].use_count() == 2);
+        CHECK_FALSE(dst[1]);
+        CHECK(dst[2]->a == 2);
+        for (int i = 0; i < 3; ++i) dst[i].~sptr(); // the control blocks check the addresses
+
+        alignas(wptr) unsigned char wbuf[2][sizeof(wptr)];
+        auto wsrc = new (wbuf[0]) wptr(p);
+        auto wdst = reinterpret_cast<wptr*>(wbuf[1]);
+        xmem::uninitialized_relocate(wsrc, wsrc + 1, wdst);
+        CHECK(wdst->lock() == p);
+        wdst->~wptr();
+
+        // a run of pointers to the same control block is transferred with a single call
+        auto cb = p.t_owner();
+        auto batched = cb->num_batched_transfers;
+        for (int i = 0; i < 3; ++i) new (src + i) sptr(p);
+        xmem::uninitialized_relocate(src, src + 3, dst);
+        CHECK(cb->num_batched_transfers == batched + 1);
+        CHECK(p.use_count() == 4);
+        for (int i = 0; i < 3; ++i) dst[i].~sptr();
+
+        using uptr = xmem::unique_ptr<obj, xmem::control_block_deleter<xmem::bookkeeping_control_block_factory>>;
+        static_assert(xmem::relocation_traits<uptr>::bitwise);
+        alignas(uptr) unsigned char ubuf[2][2 * sizeof(uptr)];
+        auto usrc = reinterpret_cast<uptr*>(ubuf[0]);
+        auto udst = reinterpret_cast<uptr*>(ubuf[1]);
+        new (usrc) uptr(xmem::make_bookkeeping_shared<obj>(3).unshare());
+        new (usrc + 1) uptr(xmem::make_bookkeeping_shared<obj>(4).unshare());
+        xmem::uninitialized_relocate(usrc, usrc + 2, udst);
+        CHECK(udst[0]->a == 3);
+        CHECK(udst[1]->a == 4);
+        CHECK(udst[0].get_deleter().t_owner()->num_batched_transfers == 1);
+        for (int i = 0; i < 2; ++i) udst[i].~uptr();
+    }
+    CHECK(stats.living == 0);
+}
+
+TEST_CASE("bookkeeping weak_ptr_vector") {
+    obj::lifetime_stats stats;
+    {
+        // growth and compaction move the entries, which the control blocks check
+        xmem::basic_weak_ptr_vector<xmem::bookkeeping_control_block_factory, obj> vec;
+        std::vector<xmem::bookkeeping_shared_ptr<obj>> objects;
+        for (int i = 0; i < 40; ++i) {
+            objects.push_back(xmem::make_bookkeeping_shared<obj>(i));
+            vec.push_back(objects.back());
+        }
+        for (size_t i = 0; i < objects.size(); i += 3) {
+            objects[i].reset();
+        }
+        CHECK(vec.for_each_alive([](const xmem::bookkeeping_shared_ptr<obj>& p) { CHECK(p.use_count() == 2); }) == 26);
+        CHECK(vec.erase(objects[1]) == 1);
+        objects.resize(20);
+        CHECK(vec.compact() == 13);
+    }
+    CHECK(stats.living == 0);
+}
@@ -126,6 +126,11 @@ template <typename T>
     return bookkeeping_shared_ptr<T>(bookkeeping_control_block_factory::make_resource_cb_for_overwrite<T>(allocator<char>{}));
 }
 
+template <typename T>
+[[nodiscard]] bookkeeping_shared_ptr<T> make_bookkeeping_shared_for_overwrite(size_t n) {
+    return bookkeeping_shared_ptr<T>(bookkeeping_control_block_factory::make_resource_cb_for_overwrite<T>(allocator<char>{}, n));
+}
+
 template <typename T>
 using atomic_shared_ptr_storage = basic_atomic_shared_ptr_storage<bookkeeping_control_block_factory, T>;
 
@@ -0,0 +1,128 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/thin_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <unordered_set>
+
+TEST_SUITE_BEGIN("thin_shared_ptr");
+
+static_assert(sizeof(xmem::thin_shared_ptr<obj>) == sizeof(void*));
+static_assert(sizeof(xmem::local_thin_shared_ptr<avx_512>) == sizeof(void*));
+
+TEST_CASE("basic") {
+    obj::lifetime_stats stats;
+
+    {
+        xmem::thin_shared_ptr<obj> e;
+        CHECK_FALSE(e);
+        CHECK_FALSE(e.get());
+        CHECK(e.use_count() == 0);
+        CHECK(xmem::no_owner(e));
+        e.reset();
+        CHECK_FALSE(e);
+    }
+
+    {
+        auto o = xmem::make_thin_shared<obj>(5, "five");
+        REQUIRE(o);
+        CHECK(o->a == 5);
+        CHECK((*o).b == "five");
+        CHECK(o.use_count() == 1);
+
+        auto o2 = o;
+        CHECK(o2 == o);
+        CHECK(o2.get() == o.get());
+        CHECK(o.use_count() == 2);
+
+        auto o3 = std::move(o2);
+        CHECK_FALSE(o2);
+        CHECK(o3 == o);
+        CHECK(o.use_count() == 2);
+
+        xmem::thin_shared_ptr<const obj> co = o3;
+        CHECK(co.get() == o.get());
+        CHECK(o.use_count() == 3);
+
+        auto n = xmem::make_thin_shared<obj>(6);
+        CHECK(n != o);
+        n.swap(o3);
+        CHECK(n == o);
+        CHECK(o3->a == 6);
+        o3 = n;
+        CHECK(o.use_count() == 4);
+        CHECK(stats.living == 1);
+
+        std::unordered_set<xmem::thin_shared_ptr<obj>> set;
+        set.insert(o);
+        set.insert(n);
+        CHECK(set.size() == 1);
+    }
+
+    CHECK(stats.total == 2);
+    CHECK(stats.living == 0);
+
+    {
+        auto a = xmem::make_thin_shared<avx_512>();
+        CHECK(reinterpret_cast<uintptr_t>(a.get()) % 64 == 0);
+    }
+}
+
+TEST_CASE("to shared") {
+    obj::lifetime_stats stats;
+
+    xmem::weak_ptr<obj> w;
+    {
+        auto c = xmem::make_thin_shared<child>(1, 2);
+
+        xmem::shared_ptr<obj> s = c;
+        CHECK(s.get() == c.get());
+        CHECK(s->val() == 3);
+        CHECK(xmem::same_owner(s, c));
+        CHECK(c.use_count() == 2);
+
+        w = s;
+
+        auto s2 = c.to_shared();
+        CHECK(s2.get() == c.get());
+        CHECK(c.use_count() == 3);
+
+        xmem::shared_ptr<int> alias(s, &c->c);
+        CHECK(*alias == 2);
+
+        xmem::shared_ptr<const child> moved = std::move(c);
+        CHECK_FALSE(c);
+        CHECK(moved.use_count() == 4);
+
+        xmem::thin_shared_ptr<obj> e;
+        xmem::shared_ptr<obj> se = e;
+        CHECK_FALSE(se);
+        CHECK(xmem::no_owner(se));
+    }
+    CHECK(w.expired());
+    CHECK(stats.living == 0);
+}
+
+struct sf_obj : public xmem::enable_local_shared_from_this<sf_obj> {
+    int val = 0;
+    explicit sf_obj(int v) : val(v) {}
+};
+
+TEST_CASE("local and shared from") {
+    auto p = xmem::make_local_thin_shared<sf_obj>(3);
+    CHECK(p->val == 3);
+
+    auto s = p->shared_from_this();
+    CHECK(s.get() == p.get());
+    CHECK(p.use_count() == 2);
+
+    xmem::local_weak_ptr<sf_obj> w = p->weak_from_this();
+    p.reset();
+    CHECK(s.use_count() == 1);
+    s.reset();
+    CHECK(w.expired());
+}
@@ -0,0 +1,102 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/shared_ptr.hpp>
+#include <xmem/local_shared_ptr.hpp>
+
+#include <xmem/test_types.hpp>
+
+TEST_SUITE_BEGIN("unique_shareable");
+
+static_assert(sizeof(xmem::unique_shareable_ptr<obj>) == 2 * sizeof(void*));
+
+TEST_CASE("unique_shareable") {
+    obj::lifetime_stats stats;
+
+    {
+        auto u = xmem::make_unique_shareable<obj>(1, "one");
+        CHECK(u->a == 1);
+        CHECK(u->b == "one");
+        auto cb = u.get_deleter().t_owner();
+        CHECK(cb);
+
+        auto u2 = std::move(u);
+        CHECK_FALSE(u);
+        CHECK(u2.get_deleter().t_owner() == cb);
+
+        auto p = u2.get();
+        xmem::shared_ptr<obj> s = std::move(u2);
+        CHECK_FALSE(u2);
+        CHECK(s.get() == p);
+        CHECK(s.t_owner() == cb); // same control block
+        CHECK(s.use_count() == 1);
+        CHECK(stats.living == 1);
+    }
+    CHECK(stats.living == 0);
+    CHECK(stats.total == 1);
+
+    {
+        // destroyed as unique
+        auto u = xmem::make_local_unique_shareable<child>(1, 2);
+        xmem::local_unique_shareable_ptr<obj> o = std::move(u);
+        CHECK(o->val() == 3);
+        o.reset();
+        CHECK(stats.living == 0);
+
+        o = xmem::make_local_unique_shareable<obj>(5);
+        xmem::local_shared_ptr<obj> s;
+        s = std::move(o);
+        CHECK(s->a == 5);
+    }
+    CHECK(stats.living == 0);
+}
+
+TEST_CASE("unshare") {
+    obj::lifetime_stats stats;
+
+    auto s = xmem::make_shared<obj>(3);
+    auto cb = s.t_owner();
+    {
+        auto s2 = s;
+        CHECK_FALSE(s.unshare());
+        CHECK(s.use_count() == 2);
+    }
+    {
+        xmem::weak_ptr<obj> w = s;
+        CHECK_FALSE(s.unshare());
+        CHECK(s);
+    }
+
+    auto u = s.unshare();
+    CHECK_FALSE(s);
+    REQUIRE(u);
+    CHECK(u->a == 3);
+    CHECK(u.get_deleter().t_owner() == cb);
+
+    // and back
+    xmem::shared_ptr<obj> s3(std::move(u));
+    CHECK(s3.t_owner() == cb);
+
+    // any control block can be unshared
+    xmem::shared_ptr<obj> raw(new obj(4));
+    auto ru = raw.unshare();
+    CHECK(ru->a == 4);
+    ru.reset();
+    CHECK(stats.living == 1);
+
+    // a null alias can't be unshared: the unique_ptr would be empty, but own the control block
+    xmem::shared_ptr<obj> null_alias(xmem::make_shared<obj>(5), static_cast<obj*>(nullptr));
+    CHECK_FALSE(null_alias.unshare());
+    CHECK(null_alias.use_count() == 1);
+    null_alias.reset();
+    CHECK(stats.living == 1);
+
+    xmem::unique_shareable_ptr<obj> a = xmem::make_unique_shareable<obj>(10);
+    xmem::unique_shareable_ptr<obj> b = xmem::make_unique_shareable<obj>(20);
+    auto acb = a.get_deleter().t_owner();
+    a.swap(b);
+    CHECK(a->a == 20);
+    CHECK(b.get_deleter().t_owner() == acb);
+}
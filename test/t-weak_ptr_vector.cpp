@@ -0,0 +1,113 @@
+// Copyright (c) Borislav Stanimirov
+// SPDX-License-Identifier: MIT
+//
+#include <doctest/doctest.h>
+
+#include <xmem/weak_ptr_vector.hpp>
+
+#include <xmem/test_types.hpp>
+
+#include <stdexcept>
+#include <vector>
+
+TEST_SUITE_BEGIN("weak_ptr_vector");
+
+TEST_CASE("basic") {
+    obj::lifetime_stats stats;
+    xmem::weak_ptr_vector<obj> vec;
+    CHECK(vec.empty());
+    int calls = 0;
+    CHECK(vec.for_each_alive([&](const xmem::shared_ptr<obj>&) { ++calls; }) == 0);
+    CHECK(calls == 0);
+
+    std::vector<xmem::shared_ptr<obj>> objects;
+    for (int i = 0; i < 20; ++i) {
+        objects.push_back(xmem::make_shared<obj>(i));
+        vec.push_back(objects.back());
+    }
+    vec.push_back(xmem::shared_ptr<obj>{}); // not added
+    xmem::weak_ptr<obj> w = objects[3];
+    vec.push_back(w);
+    CHECK(vec.size() == 21);
+
+    for (size_t i = 0; i < objects.size(); i += 2) {
+        objects[i].reset();
+    }
+    CHECK(stats.living == 10);
+
+    int sum = 0;
+    auto alive = vec.for_each_alive([&](const xmem::shared_ptr<obj>& p) {
+        CHECK(p.use_count() == 2);
+        sum += p->a;
+    });
+    CHECK(alive == 11);
+    CHECK(vec.size() == 11);
+    CHECK(sum == 100 + 3);
+
+    CHECK(vec.erase(w) == 2);
+    CHECK(vec.size() == 9);
+    CHECK(vec.erase(w) == 0);
+
+    objects.clear();
+    CHECK(stats.living == 0);
+    CHECK(vec.size() == 9);
+    CHECK(vec.compact() == 9);
+    CHECK(vec.empty());
+
+    auto p = xmem::make_shared<obj>(1);
+    vec.push_back(p);
+    auto moved = std::move(vec);
+    CHECK(vec.empty());
+    CHECK(moved.size() == 1);
+    vec = std::move(moved);
+    CHECK(vec.size() == 1);
+    vec.clear();
+    CHECK(vec.empty());
+    CHECK(p.use_count() == 1);
+}
+
+TEST_CASE("compact on push") {
+    xmem::local_weak_ptr_vector<int> vec;
+    auto keep = xmem::make_local_shared<int>(-1);
+    vec.push_back(keep);
+    // churn: every pushed object expires right away
+    for (int i = 0; i < 1000; ++i) {
+        vec.push_back(xmem::make_local_shared<int>(i));
+    }
+    CHECK(vec.capacity() <= 16);
+
+    // alive objects make it grow
+    std::vector<xmem::local_shared_ptr<int>> objects;
+    for (int i = 0; i < 100; ++i) {
+        objects.push_back(xmem::make_local_shared<int>(i));
+        vec.push_back(objects.back());
+    }
+    CHECK(vec.capacity() >= 101);
+    int n = 0;
+    CHECK(vec.for_each_alive([&](const xmem::local_shared_ptr<int>&) { ++n; }) == 101);
+    CHECK(n == 101);
+}
+
+TEST_CASE("exceptions") {
+    xmem::weak_ptr_vector<int> vec;
+    std::vector<xmem::shared_ptr<int>> objects;
+    for (int i = 0; i < 10; ++i) {
+        objects.push_back(xmem::make_shared<int>(i));
+        vec.push_back(objects.back());
+    }
+    objects[0].reset();
+    objects[1].reset();
+    objects[8].reset();
+
+    int calls = 0;
+    CHECK_THROWS_AS(vec.for_each_alive([&](const xmem::shared_ptr<int>& p) {
+        ++calls;
+        if (*p == 4) throw std::runtime_error("x");
+    }), std::runtime_error);
+    CHECK(calls == 3);
+    CHECK(vec.size() == 8); // the expired ones after the throw are still there
+
+    int sum = 0;
+    CHECK(vec.for_each_alive([&](const xmem::shared_ptr<int>& p) { sum += *p; }) == 7);
+    CHECK(sum == 2 + 3 + 4 + 5 + 6 + 7 + 9);
+}